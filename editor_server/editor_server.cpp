@@ -3,6 +3,13 @@
 #include <core/globals.h>
 #include <core/io/json.h>
 #include <tools/editor/editor_settings.h>
+#include <core/hashfuncs.h>
+#include <string.h>
+#include "trace.h"
+#include "traffic_capture.h"
+#include "request_coalescer.h"
+#include "services/source_cache.h"
+#include "services/script_dependencies.h"
 
 #define CLOSE_CLIENT_COND(m_cond, m_cd) \
 { if ( m_cond ) {	\
@@ -13,141 +20,627 @@
 namespace gdexplorer {
 
 	void EditorServer::_close_client(EditorServer::ClientData *cd) {
-		cd->connection->disconnect_from_host();
+		Ref<StreamPeerTCP> tcp = cd->connection;
+		if (tcp.is_valid())
+			tcp->disconnect_from_host();
+		Ref<StreamPeerUnix> local = cd->connection;
+		if (local.is_valid())
+			local->disconnect_from_host();
+		cd->server->connection_memory.bytes -= cd->buffer_bytes;
 		cd->server->wait_mutex->lock();
 		cd->server->to_wait.insert(cd->thread);
 		cd->server->wait_mutex->unlock();
 		memdelete(cd);
 	}
 
+	void EditorServer::_update_buffer_memory(EditorServer::ClientData *cd) {
+		// A single large request should not keep its buffers for the rest of the connection
+		cd->read_buffer.trim(MAX_IDLE_BUFFER);
+		cd->write_buffer.trim(MAX_IDLE_BUFFER);
+		cd->body_buffer.trim(MAX_IDLE_BUFFER);
+		int64_t bytes = cd->read_buffer.capacity() + cd->write_buffer.capacity() + cd->body_buffer.capacity();
+		cd->server->connection_memory.bytes += bytes - cd->buffer_bytes;
+		cd->buffer_bytes = bytes;
+	}
+
+	static const char* _methods[]={
+		"GET",
+		"HEAD",
+		"POST",
+		"PUT",
+		"DELETE",
+		"OPTIONS",
+		"TRACE",
+		"CONNECT"
+	};
+
+	static inline bool _is_space(uint8_t c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	static String _span_string(const uint8_t* p_buffer, int p_from, int p_to) {
+		String s;
+		if (p_to > p_from)
+			s.parse_utf8((const char*)p_buffer + p_from, p_to - p_from);
+		return s;
+	}
+
+	bool EditorServer::_parse_header(Request &request, const uint8_t *p_buffer, int p_len) {
+		int pos = 0;
+		bool first_line = true;
+		while (pos < p_len) {
+			int line_end = pos;
+			while (line_end < p_len && p_buffer[line_end] != '\n')
+				line_end++;
+			int from = pos, to = line_end;
+			pos = line_end + 1;
+			while (from < to && _is_space(p_buffer[from]))
+				from++;
+			while (to > from && _is_space(p_buffer[to-1]))
+				to--;
+			if (from == to)
+				continue;
+
+			if (first_line) {
+				first_line = false;
+				// Parse command, url and protocol
+				int parts[3][2];
+				int count = 0;
+				int i = from;
+				while (i < to && count < 3) {
+					int start = i;
+					while (i < to && p_buffer[i] != ' ')
+						i++;
+					parts[count][0] = start;
+					parts[count][1] = i;
+					count++;
+					while (i < to && p_buffer[i] == ' ')
+						i++;
+				}
+				if (count < 3)
+					return false;
+
+				int method_idx = -1;
+				for (int j = 0; j < METHOD_MAX; j++) {
+					const char* m = _methods[j];
+					int len = parts[0][1] - parts[0][0];
+					if (strncmp(m, (const char*)p_buffer + parts[0][0], len) == 0 && m[len] == 0) {
+						method_idx = j;
+						break;
+					}
+				}
+				if (method_idx < 0)
+					return false;
+
+				request.method = (Method) method_idx;
+				request.url = _span_string(p_buffer, parts[1][0], parts[1][1]);
+				request.protocol = _span_string(p_buffer, parts[2][0], parts[2][1]);
+			} else {
+				int sep = from;
+				while (sep < to && p_buffer[sep] != ':')
+					sep++;
+				HTTPSpan name, value;
+				name.offset = from;
+				name.length = sep;
+				while (name.length > from && _is_space(p_buffer[name.length-1]))
+					name.length--;
+				name.length -= from;
+				value.offset = sep < to ? sep + 1 : to;
+				while (value.offset < to && _is_space(p_buffer[value.offset]))
+					value.offset++;
+				value.length = to - value.offset;
+
+				if (name.length == 0 || value.length == 0)
+					continue;
+				request.header.add(name, value);
+			}
+		}
+		// Negative when the field is there but not a length
+		request.body_size = request.header.has(HTTP_HEADER_CONTENT_LENGTH) ? request.header.get_int(HTTP_HEADER_CONTENT_LENGTH, -1) : 0;
+		return !first_line;
+	}
+
+	void EditorServer::Request::send_response(const String &p_body) {
+		CharString utf = p_body.utf8();
+		send_response((const uint8_t*)utf.get_data(), utf.length());
+	}
+
+	void EditorServer::Request::write_head(HTTPBuffer &r_head, int p_content_length) {
+		r_head.append("HTTP/1.1 ");
+		r_head.append(response.status);
+		r_head.append("\r\nserver: Godot Editor Server\r\n");
+		response.header.write(r_head);
+
+		if (!response.header.has(HTTP_HEADER_CONNECTION) && header.has(HTTP_HEADER_CONNECTION)) {
+			r_head.append("connection: ");
+			r_head.append(header.get(HTTP_HEADER_CONNECTION));
+			r_head.append("\r\n");
+		}
+
+		if (p_content_length < 0) {
+			r_head.append("transfer-encoding: chunked\r\n");
+		} else {
+			// Length of the encoded body, not of the characters in it
+			r_head.append("content-length: ");
+			r_head.append_int(p_content_length);
+			r_head.append("\r\n");
+		}
+		r_head.append("\r\n");
+	}
+
+	HTTPEncoding EditorServer::Request::get_accepted_encoding() const {
+		if (get_compression_threshold() <= 0 || !header.has(HTTP_HEADER_ACCEPT_ENCODING))
+			return HTTP_ENCODING_IDENTITY;
+		return http_choose_encoding(header.get(HTTP_HEADER_ACCEPT_ENCODING));
+	}
+
+	void EditorServer::Request::set_content_encoding(HTTPEncoding p_encoding) {
+		response.set_header(HTTP_HEADER_CONTENT_ENCODING, http_encoding_name(p_encoding));
+		String etag = response.header.get(HTTP_HEADER_ETAG);
+		if (!etag.empty() && !etag.begins_with("W/"))
+			response.set_header(HTTP_HEADER_ETAG, "W/" + etag);
+	}
+
+	void EditorServer::Request::send_response(const uint8_t *p_body, int p_len) {
+		// The client already holds this version of the result
+		if (response.header.has(HTTP_HEADER_ETAG) && header.has(HTTP_HEADER_IF_NONE_MATCH) &&
+				http_etag_matches(header.get(HTTP_HEADER_IF_NONE_MATCH), response.header.get(HTTP_HEADER_ETAG))) {
+			response.status = "304 Not Modified";
+			p_body = nullptr;
+			p_len = 0;
+		}
+		Vector<uint8_t> encoded;
+		int threshold = get_compression_threshold();
+		if (threshold > 0 && p_len >= threshold) {
+			response.set_header(HTTP_HEADER_VARY, "accept-encoding");
+			HTTPEncoding encoding = get_accepted_encoding();
+			if (encoding != HTTP_ENCODING_IDENTITY) {
+				EDITOR_SERVER_TRACE("compress");
+				// Bodies with an ETag are stable, their compressed form is kept for the next request
+				if (HTTPCompression::encode(encoding, response.header.get(HTTP_HEADER_ETAG), p_body, p_len, encoded)) {
+					set_content_encoding(encoding);
+					p_body = encoded.ptr();
+					p_len = encoded.size();
+				}
+			}
+		}
+		HTTPBuffer& head = cd->write_buffer;
+		head.clear();
+		write_head(head, p_len);
+		http_send_gather(cd->connection, head, p_body, p_len);
+	}
+
+	EditorServer::ChunkedResponse::ChunkedResponse(Request *p_request): request(p_request) {
+		encoding = request->get_accepted_encoding();
+		decided = encoding == HTTP_ENCODING_IDENTITY;
+	}
+
+	Error EditorServer::ChunkedResponse::write(const uint8_t *p_data, int p_len) {
+		if (p_len <= 0)
+			return OK;
+		if (decided)
+			return encoding == HTTP_ENCODING_IDENTITY ? _send_chunk(p_data, p_len) : _encode(p_data, p_len, false);
+		// Held back until it is clear whether compressing is worth it, the header block waits as well
+		pending.append(p_data, p_len);
+		if (pending.size() < request->get_compression_threshold())
+			return OK;
+		decided = true;
+		request->response.set_header(HTTP_HEADER_VARY, "accept-encoding");
+		if (deflater.begin(encoding, HTTPDeflater::LEVEL_FASTEST) != OK) {
+			encoding = HTTP_ENCODING_IDENTITY;
+			return _send_chunk(pending.ptr(), pending.size());
+		}
+		request->set_content_encoding(encoding);
+		return _encode(pending.ptr(), pending.size(), false);
+	}
+
+	Error EditorServer::ChunkedResponse::_encode(const uint8_t *p_data, int p_len, bool p_finish) {
+		EDITOR_SERVER_TRACE("compress");
+		uint64_t begin = OS::get_singleton()->get_ticks_usec();
+		encoded.clear();
+		Error err = deflater.write(p_data, p_len, encoded, p_finish);
+		compress_usec += OS::get_singleton()->get_ticks_usec() - begin;
+		raw_bytes += p_len;
+		encoded_bytes += encoded.size();
+		if (err != OK)
+			return err;
+		return _send_chunk(encoded.ptr(), encoded.size());
+	}
+
+	Error EditorServer::ChunkedResponse::_send_chunk(const uint8_t *p_data, int p_len) {
+		if (p_len <= 0)
+			return OK;
+		HTTPBuffer& head = request->cd->write_buffer;
+		head.clear();
+		if (!started) {
+			request->write_head(head, -1);
+			started = true;
+		}
+		// The chunk terminator of the previous chunk travels with this one
+		if (pending_crlf)
+			head.append("\r\n");
+		head.append_hex(p_len);
+		head.append("\r\n");
+		pending_crlf = true;
+		return http_send_gather(request->cd->connection, head, p_data, p_len);
+	}
+
+	Error EditorServer::ChunkedResponse::finish() {
+		Error err = OK;
+		if (!decided) {
+			// Stayed below the threshold
+			decided = true;
+			encoding = HTTP_ENCODING_IDENTITY;
+			err = _send_chunk(pending.ptr(), pending.size());
+		} else if (encoding != HTTP_ENCODING_IDENTITY) {
+			err = _encode(nullptr, 0, true);
+			deflater.end();
+			HTTPCompression::record(raw_bytes, encoded_bytes, compress_usec);
+		}
+		if (err != OK)
+			return err;
+		HTTPBuffer& head = request->cd->write_buffer;
+		head.clear();
+		if (!started) {
+			request->write_head(head, -1);
+			started = true;
+		}
+		if (pending_crlf)
+			head.append("\r\n");
+		head.append("0\r\n\r\n");
+		pending_crlf = false;
+		return request->cd->connection->put_data(head.ptr(), head.size());
+	}
+
+	void EditorServer::ServiceJob::run() {
+		EditorServerTrace::record("queued", queued_usec, OS::get_singleton()->get_ticks_usec());
+		// Identical requests keep joining until finish(), the response is buffered for all of them
+		if (flight)
+			RequestCoalescer::start(flight);
+		if (call) {
+			EDITOR_SERVER_TRACE("resolve");
+			if (sink) {
+				JSONWriter writer(sink);
+				call->resolve(*body, writer);
+				writer.flush();
+				return;
+			}
+			request->response.status = "200 OK";
+			request->response.set_header(HTTP_HEADER_CONTENT_TYPE, "application/json; charset=UTF-8");
+			ChunkedResponse stream(request);
+			{
+				JSONWriter writer(&stream);
+				call->resolve(*body, writer);
+				writer.flush();
+			}
+			stream.finish();
+			streamed = true;
+			return;
+		}
+		const Ref<EditorServerService>& service = *this->service;
+		if (service->can_resolve_async(data)) {
+			Ref<ServiceCompletion> async;
+			async.instance();
+			async->set_request(data);
+			if (service->resolve_async(data, async)) {
+				completion = async;
+				return;
+			}
+		}
+		if (sink) {
+			EDITOR_SERVER_TRACE("resolve");
+			JSONWriter writer(sink);
+			if (!service->resolve_stream(data, writer)) {
+				Dictionary result = service->resolve(data);
+				EditorServerService::strip_internal_fields(result);
+				writer.raw(JSON::print(result).utf8());
+			}
+			writer.flush();
+			return;
+		}
+		if (request->accepts_chunked()) {
+			// Let the service write its result straight to the connection
+			request->response.status = "200 OK";
+			request->response.set_header(HTTP_HEADER_CONTENT_TYPE, "application/json; charset=UTF-8");
+			ChunkedResponse stream(request);
+			{
+				EDITOR_SERVER_TRACE("resolve");
+				JSONWriter writer(&stream);
+				streamed = service->resolve_stream(data, writer);
+				if (streamed)
+					writer.flush();
+			}
+			if (streamed) {
+				EDITOR_SERVER_TRACE("write");
+				stream.finish();
+				return;
+			}
+		}
+		EDITOR_SERVER_TRACE("resolve");
+		data = service->resolve(data);
+	}
+
+	// Results depend on the server build as well as on the request
+	static const char* _build_stamp = __DATE__ " " __TIME__;
+
+	String EditorServer::_make_etag(const String &p_action, const HTTPBuffer &p_body, const String &p_version) {
+		uint32_t hash = hash_djb2_buffer(p_body.ptr(), p_body.size());
+		hash = hash_djb2_one_32(p_action.hash(), hash);
+		hash = hash_djb2_one_32(p_version.hash(), hash);
+		hash = hash_djb2_one_32(String(_build_stamp).hash(), hash);
+		// Second hash over the same input in another order, 32 bits alone collide too easily for a cache key
+		uint32_t check = hash_djb2_one_32(p_version.hash(), String(_build_stamp).hash());
+		check = hash_djb2_buffer(p_body.ptr(), p_body.size(), check);
+		return "\"" + String::num_int64(hash, 16) + String::num_int64(check, 16) + "\"";
+	}
+
+	void EditorServer::_send_encoded(Request &request, const CharString &p_json) {
+		EDITOR_SERVER_TRACE("write");
+		request.response.status = "200 OK";
+		request.response.set_header(HTTP_HEADER_CONTENT_TYPE, "application/json; charset=UTF-8");
+		request.send_response((const uint8_t*)p_json.get_data(), p_json.length());
+	}
+
+	bool EditorServer::_handle_typed(Request &request) {
+		const HTTPBuffer& body_buffer = request.cd->body_buffer;
+		JSONObjectView body;
+		if (!body.parse(body_buffer.ptr(), body_buffer.size()) || !body.has("action"))
+			return false;
+		String action = body.get_string("action");
+		const std::map<String, ServiceEntry>& services = request.cd->server->services;
+		auto it = services.find(action);
+		// Scripts only see requests as dictionaries
+		if (it == services.end() || it->second.service.is_null() || it->second.service->get_script_instance())
+			return false;
+		const ServiceEntry& entry = it->second;
+		ServiceCall* call;
+		{
+			EDITOR_SERVER_TRACE("decode");
+			call = entry.service->decode(body);
+		}
+		if (!call)
+			return false;
+
+		int timeout = body.has("timeout") ? int(body.get_int("timeout")) : request.cd->server->get_action_timeout(action);
+		call->deadline = ServiceDeadline::after(timeout);
+		String version = call->deadline.is_set() ? String() : call->get_etag();
+		if (!version.empty()) {
+			request.response.set_header(HTTP_HEADER_ETAG, _make_etag(action, body_buffer, version));
+			if (request.header.has(HTTP_HEADER_IF_NONE_MATCH) &&
+					http_etag_matches(request.header.get(HTTP_HEADER_IF_NONE_MATCH), request.response.header.get(HTTP_HEADER_ETAG))) {
+				memdelete(call);
+				request.send_response();
+				return true;
+			}
+		}
+		RequestCoalescer::Flight* flight = nullptr;
+		bool leader = true;
+		if (call->can_coalesce())
+			flight = RequestCoalescer::join(action, body_buffer.ptr(), body_buffer.size(), leader);
+		if (flight && !leader) {
+			memdelete(call);
+			CharString response;
+			{
+				EDITOR_SERVER_TRACE("coalesced");
+				response = RequestCoalescer::wait(flight);
+			}
+			_send_encoded(request, response);
+			return true;
+		}
+
+		ServiceJob job;
+		JSONBufferSink sink;
+		job.request = &request;
+		job.service = &entry.service;
+		job.call = call;
+		job.body = &body;
+		job.queued_usec = OS::get_singleton()->get_ticks_usec();
+		job.flight = flight;
+		// Without chunked encoding the length has to be known before the body goes out,
+		// small responses are cheaper in one write with it anyway
+		if (flight || !call->is_streamed() || !request.accepts_chunked())
+			job.sink = &sink;
+		request.cd->server->scheduler->run(&job, call->get_priority(entry.priority));
+		memdelete(call);
+		if (job.streamed)
+			return true;
+		CharString response = sink.get_data();
+		if (job.flight)
+			RequestCoalescer::finish(job.flight, response);
+		_send_encoded(request, response);
+		return true;
+	}
+
+	void EditorServer::_handle_post(Request &request) {
+		{
+			EDITOR_SERVER_TRACE("read body");
+			if (request.read_body() != OK)
+				request.cd->body_buffer.clear();
+		}
+		if (_handle_typed(request))
+			return;
+
+		// Read and parse body as json
+		String body = request.get_utf8_body();
+		Variant _data;
+		String errmsg;
+		int errline = -1;
+		Error parse_err;
+		{
+			EDITOR_SERVER_TRACE("parse json");
+			parse_err = JSON::parse(body, _data, errmsg, errline);
+		}
+		if (parse_err != OK) {
+			request.response.status = "400 Bad Request";
+			request.response.set_header(HTTP_HEADER_ACCEPT, "application/json");
+			request.response.set_header(HTTP_HEADER_ACCEPT_CHARSET, "utf-8");
+			request.send_response();
+			return;
+		}
+		Dictionary data = _data;
+		if (request.header.get_extra_count()) {
+			Dictionary headers;
+			for (int i = 0; i < request.header.get_extra_count(); i++)
+				headers[request.header.get_extra_name(i).to_lower()] = request.header.get_extra_value(i);
+			data["headers"] = headers;
+		}
+		if (!data.has("action")) {
+			data["error"] = "No action found in the request body";
+		}
+		else {
+			const std::map<String, ServiceEntry>& services = request.cd->server->services;
+			auto it = services.find(data["action"]);
+			if(it == services.end())
+				data["error"] = "No service found for the action";
+			else {
+				const ServiceEntry& entry = it->second;
+				if(!entry.service.is_null()) {
+					int timeout = data.has("timeout")? int(data["timeout"]) : request.cd->server->get_action_timeout(data["action"]);
+					ServiceDeadline::stamp(data, timeout);
+					// A result cut short by its deadline must not be served as the current version
+					String version = ServiceDeadline::from_request(data).is_set() ? String() : entry.service->get_etag(data);
+					if (!version.empty()) {
+						request.response.set_header(HTTP_HEADER_ETAG, _make_etag(data["action"], request.cd->body_buffer, version));
+						if (request.header.has(HTTP_HEADER_IF_NONE_MATCH) &&
+								http_etag_matches(request.header.get(HTTP_HEADER_IF_NONE_MATCH), request.response.header.get(HTTP_HEADER_ETAG))) {
+							request.send_response();
+							return;
+						}
+					}
+					RequestCoalescer::Flight* flight = nullptr;
+					bool leader = true;
+					if (entry.service->can_coalesce(data))
+						flight = RequestCoalescer::join(data["action"], request.cd->body_buffer.ptr(), request.cd->body_buffer.size(), leader);
+					if (flight && !leader) {
+						CharString response;
+						{
+							EDITOR_SERVER_TRACE("coalesced");
+							response = RequestCoalescer::wait(flight);
+						}
+						_send_encoded(request, response);
+						return;
+					}
+
+					ServiceJob job;
+					JSONBufferSink sink;
+					job.request = &request;
+					job.data = data;
+					job.service = &entry.service;
+					job.queued_usec = OS::get_singleton()->get_ticks_usec();
+					job.flight = flight;
+					if (flight)
+						job.sink = &sink;
+					if (entry.service->runs_on_connection(data))
+						job.run();
+					else
+						request.cd->server->scheduler->run(&job, entry.service->get_request_priority(data, entry.priority));
+					if (job.completion.is_valid()) {
+						// Parked without holding a worker until the service completes
+						bool completed;
+						{
+							EDITOR_SERVER_TRACE("await");
+							completed = job.completion->wait(ServiceDeadline::from_request(data));
+						}
+						if (completed)
+							data = job.completion->get_result();
+						else
+							data["error"] = "The service did not complete in time";
+						if (job.flight) {
+							EditorServerService::strip_internal_fields(data);
+							CharString response = JSON::print(data).utf8();
+							RequestCoalescer::finish(job.flight, response);
+							_send_encoded(request, response);
+							return;
+						}
+					}
+					else if (job.flight) {
+						CharString response = sink.get_data();
+						RequestCoalescer::finish(job.flight, response);
+						_send_encoded(request, response);
+						return;
+					}
+					else if (job.streamed)
+						return;
+					else
+						data = job.data;
+				}
+			}
+		}
+
+		// Done! Deliver <3
+		String json;
+		{
+			EDITOR_SERVER_TRACE("serialize");
+			EditorServerService::strip_internal_fields(data);
+			json = JSON::print(data);
+		}
+		EDITOR_SERVER_TRACE("write");
+		request.response.status = "200 OK";
+		request.response.set_header(HTTP_HEADER_CONTENT_TYPE, "application/json; charset=UTF-8");
+		request.send_response(json);
+	}
+
 	void EditorServer::_subthread_start(void *s) {
 		ClientData *cd = (ClientData*)s;
-		cd->connection->set_nodelay(true);
+		Ref<StreamPeerTCP> tcp = cd->connection;
+		if (tcp.is_valid())
+			tcp->set_nodelay(true);
 
-		static const char* _methods[METHOD_MAX]={
-			"GET",
-			"HEAD",
-			"POST",
-			"PUT",
-			"DELETE",
-			"OPTIONS",
-			"TRACE",
-			"CONNECT"
-		};
+		HTTPBuffer& request_str = cd->read_buffer;
+		request_str.clear();
 
-		Vector<uint8_t> request_str;
+		uint64_t request_begin = 0;
 
 		while(!cd->quit) {
 			uint8_t byte;
 			Error err = cd->connection->get_data(&byte, 1);
 			CLOSE_CLIENT_COND(err!=OK, cd);
 
+			if (request_str.size() == 0)
+				request_begin = OS::get_singleton()->get_ticks_usec();
 			request_str.push_back(byte);
+			const uint8_t* rb = request_str.ptr();
 			int rs = request_str.size();
 			// Read request content from connection done
-			if ((rs>=2 && request_str[rs-2]=='\n' && request_str[rs-1]=='\n') ||
-					(rs>=4 && request_str[rs-4]=='\r' && request_str[rs-3]=='\n' && rs>=4 && request_str[rs-2]=='\r' && request_str[rs-1]=='\n')) {
-
-				request_str.push_back(0);
-
-				// End of request header, parse
-				String header;
-				CLOSE_CLIENT_COND(header.parse_utf8((const char*)request_str.ptr()), cd);
-				Vector<String> header_lines = header.split("\n");
-				request_str.clear();
+			if ((rs>=2 && rb[rs-2]=='\n' && rb[rs-1]=='\n') ||
+					(rs>=4 && rb[rs-4]=='\r' && rb[rs-3]=='\n' && rb[rs-2]=='\r' && rb[rs-1]=='\n')) {
 
+				// End of request header, parse in place
 				Request request(cd);
-
-				for (int i = 0; i < header_lines.size(); i++) {
-					String s = header_lines[i].strip_edges();
-					if (s.length() == 0)
-						continue;
-
-					if (i == 0) {
-						// Parse command, url and protocol
-						Vector<String> parts = s.split(" ");
-						CLOSE_CLIENT_COND(parts.size() < 3, cd);
-
-						int method_idx = -1;
-						for (int j = 0; j < METHOD_MAX; j++) {
-							if (_methods[j] == parts[0]) {
-								method_idx = j;
-								break;
-							}
-						}
-						CLOSE_CLIENT_COND(method_idx < 0, cd);
-
-						request.method = (Method) method_idx;
-						request.url = parts[1];
-						request.protocol = parts[2];
-					} else {
-						int sep=s.find(":");
-						if (sep<0)
-							sep=s.length();
-						String field_name = s.substr(0,sep).strip_edges().to_lower();
-						String field_value = s.substr(sep+1,s.length()).strip_edges();
-
-						if (field_name.empty() || field_value.empty())
-							continue;
-
-						if (field_name == "content-length") {
-							request.body_size = field_value.to_int();
-						}
-
-						request.header.insert(field_name, field_value);
-					}
-				}
+				bool parsed = _parse_header(request, rb, rs);
+				request_str.clear();
+				EditorServerTrace::record("read header", request_begin, OS::get_singleton()->get_ticks_usec());
+				CLOSE_CLIENT_COND(!parsed, cd);
 
 				switch (request.method) {
 					case METHOD_POST: {
+							if (request.body_size < 0 || request.body_size > MAX_BODY_SIZE) {
+								// The body stays unread on the connection, it can not be used any further
+								request.response.status = request.body_size < 0 ? "400 Bad Request" : "413 Payload Too Large";
+								request.response.set_header(HTTP_HEADER_CONNECTION, "close");
+								request.send_response();
+								_close_client(cd);
+								return;
+							}
 							if (request.body_size == 0) {
 								// No content... ignore request
 								continue;
 							}
-
-							// Read and parse body as json
-							Variant _data;
-							String errmsg;
-							int errline = -1;
-							Error parse_err = JSON::parse(request.read_utf8_body(), _data, errmsg, errline);
-							if (parse_err != OK) {
-								request.response.status = "400 Bad Request";
-								request.response.set_header("Accept", "application/json");
-								request.response.set_header("Accept-Charset", "utf-8");
-								request.send_response();
-								break;
-							}
-							Dictionary data = _data;
-							if (!data.has("action")) {
-								data["error"] = "No action found in the request body";
-							}
-							else {
-								auto services = cd->server->services;
-								if(services.find(data["action"]) == services.end())
-									data["error"] = "No service found for the action";
-								else {
-									Ref<EditorServerService>& service = services[data["action"]];
-									if(!service.is_null()) {
-										data = service->resolve(data);
-									}
-								}
-							}
-
-
-							// Done! Deliver <3
-							request.response.status = "200 OK";
-							request.response.set_header("Content-Type", "application/json; charset=UTF-8");
-							request.send_response(JSON::print(data));
-
+							_handle_post(request);
+							if (TrafficCapture::is_capturing())
+								TrafficCapture::record(request_begin, OS::get_singleton()->get_ticks_usec(), cd->body_buffer.ptr(), cd->body_buffer.size());
 						} break;
 					default: {
 							request.response.status = "405 Method Not Allowed";
-							request.response.set_header("Allow", "POST");
+							request.response.set_header(HTTP_HEADER_ALLOW, "POST");
 							request.send_response();
 						} break;
 				}
 
-				CLOSE_CLIENT_COND(request.header["connection"] != "keep-alive", cd);
+				// The header spans point into the read buffer, decide before trimming it
+				bool keep_alive = request.header.equals(HTTP_HEADER_CONNECTION, "keep-alive");
+				_update_buffer_memory(cd);
+				CLOSE_CLIENT_COND(!keep_alive, cd);
 			}
 		}
 
@@ -162,6 +655,7 @@ namespace gdexplorer {
 				self->server->stop();
 				self->active = false;
 				self->cmd = CMD_NONE;
+				self->unix_server.stop();
 				if (self->server->listen(self->port) == OK) {
 					self->active = true;
 					print_line(String("[Editor Server]Server port started at:") + itos(self->port));
@@ -169,25 +663,35 @@ namespace gdexplorer {
 				else {
 					ERR_PRINTS(String("[Editor Server]Error open port: ") + itos(self->port));
 				}
+				if (!self->unix_socket_path.empty()) {
+					if (self->unix_server.listen(self->unix_socket_path) == OK) {
+						self->active = true;
+						print_line(String("[Editor Server]Server socket started at:") + self->unix_socket_path);
+					}
+					else {
+						ERR_PRINTS(String("[Editor Server]Error open socket: ") + self->unix_socket_path);
+					}
+				}
 			}
 			else if (self->cmd == CMD_STOP) {
 				self->server->stop();
+				self->unix_server.stop();
 				self->active = false;
 				self->cmd = CMD_NONE;
 			}
 
-			if (self->active && self->server->is_connection_available()) {
-				ClientData *cd = memnew( ClientData );
-				cd->connection = self->server->take_connection();
-				cd->server = self;
-				cd->quit = false;
-				cd->thread = Thread::create(_subthread_start, cd);
-			}
+			if (self->active && self->server->is_connection_available())
+				self->_accept(self->server->take_connection());
+			// Local tools share the same request pipeline
+			if (self->active && self->unix_server.is_connection_available())
+				self->_accept(self->unix_server.take_connection());
 
 			self->wait_mutex->lock();
 			while (self->to_wait.size()) {
 				Thread *w = self->to_wait.front()->get();
 				self->to_wait.erase(w);
+				// Closing clients take the mutex to queue their thread, never hold it while joining
+				self->wait_mutex->unlock();
 				Thread::wait_to_finish(w);
 				if(w)
 					memdelete(w);
@@ -199,28 +703,115 @@ namespace gdexplorer {
 		}
 	}
 
+	void EditorServer::_accept(const Ref<StreamPeer> &p_connection) {
+		if (p_connection.is_null())
+			return;
+		EDITOR_SERVER_TRACE("accept");
+		ClientData *cd = memnew( ClientData );
+		cd->connection = p_connection;
+		cd->server = this;
+		cd->quit = false;
+		cd->thread = Thread::create(_subthread_start, cd);
+	}
+
 	void EditorServer::_bind_methods() {
-		ClassDB::bind_method(_MD("register_service", "action:String", "service:EditorServerService"), &EditorServer::register_service);
+		ClassDB::bind_method(_MD("register_service", "action:String", "service:EditorServerService", "priority:int"), &EditorServer::register_service, DEFVAL(-1));
+		ClassDB::bind_method(_MD("set_action_timeout", "action:String", "msec:int"), &EditorServer::set_action_timeout);
+		ClassDB::bind_method(_MD("get_action_timeout", "action:String"), &EditorServer::get_action_timeout);
+		ClassDB::bind_method(_MD("set_compression_threshold", "bytes:int"), &EditorServer::set_compression_threshold);
+		ClassDB::bind_method(_MD("get_compression_threshold"), &EditorServer::get_compression_threshold);
+		ClassDB::bind_method(_MD("set_memory_limit", "mb:int"), &EditorServer::set_memory_limit);
+		ClassDB::bind_method(_MD("get_memory_limit"), &EditorServer::get_memory_limit);
 	}
 
-	void EditorServer::start(int port) {
+	void EditorServer::start(int port, const String& p_unix_socket_path) {
 		this->port = port;
+		this->unix_socket_path = p_unix_socket_path;
 		cmd = CMD_ACTIVATE;
 	}
 
+	String EditorServer::get_default_unix_socket_path() {
+		if (!UnixSocketServer::is_supported())
+			return String();
+		// Inside a directory only the user can enter, other local users must not reach the server
+		String dir = UnixSocketServer::get_runtime_dir();
+		if (dir.empty())
+			return String();
+		// sun_path is limited to about a hundred bytes, so the project is identified by a hash
+		String project = GlobalConfig::get_singleton()->globalize_path("res://");
+		return dir.plus_file("godot-editor-server-" + project.md5_text().substr(0, 16) + ".sock");
+	}
+
 	void EditorServer::stop() {
 		cmd = CMD_STOP;
 	}
 
-	void EditorServer::register_service(const String &action, const Ref<EditorServerService>& service) {
+	void EditorServer::register_service(const String &action, const Ref<EditorServerService>& service, int p_priority) {
 		if(action.length()) {
-			services[action] = service;
+			ServiceEntry& entry = services[action];
+			entry.service = service;
+			if (p_priority < 0 || p_priority >= EditorServerService::PRIORITY_MAX)
+				entry.priority = service.is_valid() ? service->get_priority() : EditorServerService::PRIORITY_NORMAL;
+			else
+				entry.priority = EditorServerService::Priority(p_priority);
+			if (service.is_valid()) {
+				List<String> headers;
+				service->get_request_headers(&headers);
+				for (List<String>::Element *E = headers.front(); E; E = E->next())
+					wanted_headers.insert(http_header_hash(E->get()));
+			}
 		}
 	}
 
+	void EditorServer::set_action_timeout(const String &p_action, int p_msec) {
+		timeouts_mutex->lock();
+		if (p_msec > 0)
+			action_timeouts[p_action] = p_msec;
+		else
+			action_timeouts.erase(p_action);
+		timeouts_mutex->unlock();
+	}
+
+	int EditorServer::get_action_timeout(const String &p_action) const {
+		timeouts_mutex->lock();
+		const Map<String, int>::Element *E = action_timeouts.find(p_action);
+		if (!E)
+			E = action_timeouts.find("default");
+		int msec = E ? E->get() : 0;
+		timeouts_mutex->unlock();
+		return msec;
+	}
+
+	void EditorServer::set_compression_threshold(int p_bytes) {
+		compression_threshold = MAX(p_bytes, 0);
+	}
+
+	void EditorServer::set_memory_limit(int p_mb) {
+		MemoryBudget::set_limit(int64_t(MAX(p_mb, 0)) * 1024 * 1024);
+	}
+
+	int EditorServer::get_memory_limit() const {
+		return MemoryBudget::get_limit() / (1024 * 1024);
+	}
+
 	EditorServer::EditorServer() {
+		// Every cache registers with the budget, so it goes first and is finalized last
+		MemoryBudget::initialize();
+		MemoryBudget::add("connection_buffers", &connection_memory);
+		set_memory_limit(256);
 		server = TCP_Server::create_ref();
 		wait_mutex = Mutex::create();
+		timeouts_mutex = Mutex::create();
+		// One worker is kept for interactive requests, bulk work gets a quarter of the rest at most
+		int workers = MAX(OS::get_singleton()->get_processor_count(), 2);
+		scheduler = memnew(RequestScheduler(workers, MAX(workers / 4, 1)));
+		TrafficCapture::initialize();
+		SourceCache::initialize();
+		ScriptDependencies::initialize();
+		RequestCoalescer::initialize();
+		HTTPCompression::initialize();
+		// Below this, compressing costs more time than sending the bytes over loopback saves
+		compression_threshold = 16384;
 		quit = false;
 		active = false;
 		cmd = CMD_NONE;
@@ -232,8 +823,18 @@ namespace gdexplorer {
 		quit = true;
 		Thread::wait_to_finish(thread);
 		memdelete(thread);
+		memdelete(scheduler);
 		memdelete(wait_mutex);
+		memdelete(timeouts_mutex);
+		TrafficCapture::finalize();
+		SourceCache::finalize();
+		RequestCoalescer::finalize();
+		HTTPCompression::finalize();
 		services.clear();
+		// Services unregister their listeners when they go
+		ScriptDependencies::finalize();
+		MemoryBudget::remove(&connection_memory);
+		MemoryBudget::finalize();
 	}
 
 }
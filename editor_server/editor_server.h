@@ -5,7 +5,16 @@
 #include <os/thread.h>
 #include <io/tcp_server.h>
 #include "services/service.h"
+#include "http_protocol.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "http_compression.h"
+#include "unix_socket.h"
+#include "request_scheduler.h"
+#include "request_coalescer.h"
+#include "memory_budget.h"
 #include <map>
+#include <atomic>
 
 namespace gdexplorer {
 
@@ -20,11 +29,30 @@ namespace gdexplorer {
 
 		struct ClientData {
 			Thread *thread;
-			Ref<StreamPeerTCP> connection;
+			Ref<StreamPeer> connection;
 			EditorServer *server;
+			HTTPBuffer read_buffer;
+			HTTPBuffer write_buffer;
+			HTTPBuffer body_buffer;
+			// Capacity of the buffers as last reported to the server
+			int64_t buffer_bytes = 0;
 			bool quit;
 		};
 
+		// Buffers of the open connections, counted against the memory budget but never evicted
+		struct ConnectionMemory : public MemoryBudget::Consumer {
+			std::atomic<int64_t> bytes;
+			virtual int64_t get_memory_usage() const override { return bytes; }
+			ConnectionMemory() : bytes(0) {}
+		};
+
+		enum {
+			// Connection buffers that grew beyond this for one large request are freed after it
+			MAX_IDLE_BUFFER = 1024 * 1024,
+			// Larger request bodies are refused before anything is allocated for them
+			MAX_BODY_SIZE = 64 * 1024 * 1024,
+		};
+
 		enum Method {
 			METHOD_GET = 0,
 			METHOD_HEAD,
@@ -38,11 +66,14 @@ namespace gdexplorer {
 		};
 
 		struct Response {
-			Map<String, String> header;
+			HTTPResponseHeaders header;
 			String status;
 
+			void set_header(HTTPHeader p_header, const String& p_value) {
+				header.set(p_header, p_value);
+			}
 			void set_header(const String& p_name, const String& p_value) {
-				header.insert(p_name.strip_edges().to_lower(), p_value.strip_edges());
+				header.set(p_name, p_value);
 			}
 		};
 
@@ -53,40 +84,104 @@ namespace gdexplorer {
 			Method method;
 			String url;
 			String protocol;
-			Map<String, String> header;
+			HTTPHeaderTable header;
 			int body_size;
 
-			String read_utf8_body() {
-				return cd->connection->get_utf8_string(body_size);
+			// Raw body bytes, kept in the connection's body buffer until the next request
+			Error read_body() {
+				HTTPBuffer& body = cd->body_buffer;
+				body.clear();
+				ERR_FAIL_COND_V(body_size < 0 || body_size > MAX_BODY_SIZE, ERR_INVALID_DATA);
+				body.reserve(body_size);
+				body.used = body_size;
+				return body_size > 0 ? cd->connection->get_data(body.data.ptr(), body_size) : OK;
 			}
 
-			void send_response(const String& p_body=String()) {
-				String resp = "HTTP/1.1 " + response.status + "\r\n";
-				resp += "server: Godot Editor Server\r\n";
-
-				for (Map<String, String>::Element *E=response.header.front(); E; E=E->next()) {
-					resp += E->key() + ": " + E->value() + "\r\n";
-				}
-
-				if (!response.header.has("connection"))
-					resp += "connection: " + header["connection"] + "\r\n";
-
-				resp += "content-length: " + itos(p_body.length()) + "\r\n";
-				resp += "\r\n";
-				resp += p_body;
-
-				CharString utf = resp.utf8();
-				cd->connection->put_data((const uint8_t*)utf.get_data(), utf.length());
+			String get_utf8_body() const {
+				String text;
+				if (cd->body_buffer.size())
+					text.parse_utf8((const char*)cd->body_buffer.ptr(), cd->body_buffer.size());
+				return text;
 			}
 
+			// Encodes status line and header fields, a negative length announces a chunked body
+			void write_head(HTTPBuffer& r_head, int p_content_length);
+			void send_response(const String& p_body=String());
+			void send_response(const uint8_t* p_body, int p_len);
+			bool accepts_chunked() const { return protocol == "HTTP/1.1"; }
+			// Coding the client takes for large bodies, identity when it takes none or compression is off
+			HTTPEncoding get_accepted_encoding() const;
+			int get_compression_threshold() const { return cd->server->compression_threshold; }
+			// Marks the response as compressed, its ETag becomes weak as the bytes differ from the identity form
+			void set_content_encoding(HTTPEncoding p_encoding);
+
 			Request(ClientData *cd) {
 				this->cd = cd;
+				this->body_size = 0;
+				header.reset(cd->read_buffer.ptr(), &cd->server->wanted_headers);
 			}
 		};
 
+		// Chunked transfer encoded response body, the header block goes out with the first chunk
+		// Compressed on the fly once the body reaches the compression threshold
+		class ChunkedResponse : public JSONSink {
+			Request* request;
+			bool started = false;
+			bool pending_crlf = false;
+			HTTPEncoding encoding;
+			// Set once the body is known to stay below the threshold or has passed it
+			bool decided;
+			HTTPBuffer pending;
+			HTTPBuffer encoded;
+			HTTPDeflater deflater;
+			int raw_bytes = 0;
+			int encoded_bytes = 0;
+			uint64_t compress_usec = 0;
+
+			Error _send_chunk(const uint8_t* p_data, int p_len);
+			Error _encode(const uint8_t* p_data, int p_len, bool p_finish);
+		public:
+			virtual Error write(const uint8_t* p_data, int p_len) override;
+			Error finish();
+			bool is_started() const { return started; }
+			ChunkedResponse(Request* p_request);
+		};
+
+		struct ServiceEntry {
+			Ref<EditorServerService> service;
+			EditorServerService::Priority priority;
+		};
+
+		// Resolves one request on a scheduler worker, the connection thread waits for it
+		struct ServiceJob : public RequestScheduler::Job {
+			Request* request;
+			Dictionary data;
+			const Ref<EditorServerService>* service;
+			uint64_t queued_usec;
+			// Encodes the whole response here instead of writing to the connection
+			JSONSink* sink = nullptr;
+			// Led by this job, cleared when nobody joined it before it ran
+			RequestCoalescer::Flight* flight = nullptr;
+			bool streamed = false;
+			// Set when the service went asynchronous, the worker is free and the connection waits on it
+			Ref<ServiceCompletion> completion;
+			// Typed path, the call writes its response from the body view
+			ServiceCall* call = nullptr;
+			const JSONObjectView* body = nullptr;
+			virtual void run() override;
+		};
+
 	private:
-		std::map<String, Ref<EditorServerService>> services;
+		std::map<String, ServiceEntry> services;
+		Set<uint32_t> wanted_headers;
+		Map<String, int> action_timeouts;
+		Mutex *timeouts_mutex;
+		int compression_threshold;
+		ConnectionMemory connection_memory;
+		RequestScheduler *scheduler;
 		Ref<TCP_Server> server;
+		UnixSocketServer unix_server;
+		String unix_socket_path;
 		Set<Thread*> to_wait;
 		Mutex *wait_mutex;
 		Thread *thread;
@@ -96,18 +191,40 @@ namespace gdexplorer {
 		bool active;
 	private:
 		static void _close_client(ClientData *cd);
+		static void _update_buffer_memory(ClientData *cd);
+		static bool _parse_header(Request& request, const uint8_t* p_buffer, int p_len);
+		static String _make_etag(const String& p_action, const HTTPBuffer& p_body, const String& p_version);
+		static void _send_encoded(Request& request, const CharString& p_json);
+		// Answers the request through a ServiceCall when the service decodes it, returns false otherwise
+		static bool _handle_typed(Request& request);
+		static void _handle_post(Request& request);
 		static void _subthread_start(void *s);
 		static void _thread_start(void *s);
+		void _accept(const Ref<StreamPeer>& p_connection);
 
 	protected:
 		static void _bind_methods();
 
 	public:
-		void start(int port);
+		// Listens on the TCP port and, when a path is given, on a Unix domain socket as well
+		void start(int port, const String& p_unix_socket_path = String());
 		void stop();
 		bool is_active() const { return active; }
 		int get_port() const { return port; }
-		void register_service(const String& action, const Ref<EditorServerService>& service);
+		String get_unix_socket_path() const { return unix_socket_path; }
+		// Per project socket path, empty where Unix domain sockets are not available
+		static String get_default_unix_socket_path();
+		// A negative priority takes the one the service asks for
+		void register_service(const String& action, const Ref<EditorServerService>& service, int p_priority = -1);
+		// Default time limit for requests of an action that carry no "timeout", "default" applies to all others
+		void set_action_timeout(const String& p_action, int p_msec);
+		int get_action_timeout(const String& p_action) const;
+		// Bodies from this many bytes on are compressed for clients that accept it, 0 turns compression off
+		void set_compression_threshold(int p_bytes);
+		int get_compression_threshold() const { return compression_threshold; }
+		// Caches give up their least recently used entries beyond this, 0 turns the limit off
+		void set_memory_limit(int p_mb);
+		int get_memory_limit() const;
 		EditorServer();
 		~EditorServer();
 	};
@@ -5,7 +5,13 @@
 #include "services/editor_action_service.h"
 #include "services/code_complete_service.h"
 #include "services/script_parse_service.h"
+#include "services/doc_query_service.h"
+#include "services/scene_index.h"
+#include "services/semantic_tokens_service.h"
+#include "services/text_search_service.h"
+#include "trace.h"
 #include <core/globals.h>
+#include <initializer_list>
 
 namespace gdexplorer {
 	EditorServerPlugin::EditorServerPlugin(EditorNode* pEditor): editor(pEditor) {
@@ -15,12 +21,33 @@ namespace gdexplorer {
 		server->register_service("editor", memnew(EditorActionService));
 		server->register_service("codecomplete", memnew(CodeCompleteService));
 		server->register_service("parsescript", memnew(ScriptParseService));
+		server->register_service("doc", memnew(DocQueryService));
+		server->register_service("sceneindex", memnew(SceneIndexService));
+		server->register_service("semantictokens", memnew(SemanticTokensService));
+		server->register_service("search", memnew(TextSearchService));
 
 		auto port = EditorSettings::get_singleton()->get("network/editor_server_port");
 		if (port.get_type() == Variant::NIL || !port.is_num())
 			port = 6570;
 		if(!EditorSettings::get_singleton()->has("network/editor_server_port"))
 			EditorSettings::get_singleton()->set("network/editor_server_port", port);
+		if(!EditorSettings::get_singleton()->has("network/editor_server_trace"))
+			EditorSettings::get_singleton()->set("network/editor_server_trace", false);
+		EditorServerTrace::set_enabled(EditorSettings::get_singleton()->get("network/editor_server_trace"));
+		if(!EditorSettings::get_singleton()->has("network/editor_server_unix_socket"))
+			EditorSettings::get_singleton()->set("network/editor_server_unix_socket", UnixSocketServer::is_supported());
+		for(const char* action : {"default", "codecomplete", "parsescript"}) {
+			String setting = String("network/editor_server_timeout/") + action;
+			if(!EditorSettings::get_singleton()->has(setting))
+				EditorSettings::get_singleton()->set(setting, 0);
+		}
+		if(!EditorSettings::get_singleton()->has("network/editor_server_compression_threshold"))
+			EditorSettings::get_singleton()->set("network/editor_server_compression_threshold", server->get_compression_threshold());
+		server->set_compression_threshold(EditorSettings::get_singleton()->get("network/editor_server_compression_threshold"));
+		if(!EditorSettings::get_singleton()->has("network/editor_server_memory_limit_mb"))
+			EditorSettings::get_singleton()->set("network/editor_server_memory_limit_mb", server->get_memory_limit());
+		server->set_memory_limit(EditorSettings::get_singleton()->get("network/editor_server_memory_limit_mb"));
+		_update_timeouts();
 		m_notificationParam.push_back(EditorSettings::NOTIFICATION_EDITOR_SETTINGS_CHANGED);
 		EditorSettings::get_singleton()->connect("settings_changed", this, "_notification", m_notificationParam);
 		GlobalConfig::get_singleton()->add_singleton( GlobalConfig::Singleton("EditorServer", server));
@@ -34,7 +61,7 @@ namespace gdexplorer {
 		switch (p_what) {
 			case NOTIFICATION_ENTER_TREE: {
 					auto port = EditorSettings::get_singleton()->get("network/editor_server_port");
-					server->start(port);
+					server->start(port, _get_unix_socket_path());
 				}
 				break;
 			case NOTIFICATION_EXIT_TREE:
@@ -42,8 +69,13 @@ namespace gdexplorer {
 				break;
 			case EditorSettings::NOTIFICATION_EDITOR_SETTINGS_CHANGED:{
 					auto port = EditorSettings::get_singleton()->get("network/editor_server_port");
-					if(int(port) != server->get_port()) {
-						server->start(port);
+					EditorServerTrace::set_enabled(EditorSettings::get_singleton()->get("network/editor_server_trace"));
+					_update_timeouts();
+					server->set_compression_threshold(EditorSettings::get_singleton()->get("network/editor_server_compression_threshold"));
+					server->set_memory_limit(EditorSettings::get_singleton()->get("network/editor_server_memory_limit_mb"));
+					String socket_path = _get_unix_socket_path();
+					if(int(port) != server->get_port() || socket_path != server->get_unix_socket_path()) {
+						server->start(port, socket_path);
 					}
 				}
 				break;
@@ -52,6 +84,22 @@ namespace gdexplorer {
 		}
 	}
 
+	void EditorServerPlugin::_update_timeouts() {
+		List<PropertyInfo> settings;
+		EditorSettings::get_singleton()->get_property_list(&settings);
+		const String prefix = "network/editor_server_timeout/";
+		for(List<PropertyInfo>::Element *E = settings.front(); E; E = E->next()) {
+			if(E->get().name.begins_with(prefix))
+				server->set_action_timeout(E->get().name.substr(prefix.length(), E->get().name.length()), EditorSettings::get_singleton()->get(E->get().name));
+		}
+	}
+
+	String EditorServerPlugin::_get_unix_socket_path() const {
+		if(!bool(EditorSettings::get_singleton()->get("network/editor_server_unix_socket")))
+			return String();
+		return EditorServer::get_default_unix_socket_path();
+	}
+
 	void EditorServerPlugin::_bind_methods() {
 		ClassDB::bind_method(_MD("_notification","p_what"),&EditorServerPlugin::_notification);
 	}
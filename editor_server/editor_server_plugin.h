@@ -12,6 +12,8 @@ namespace gdexplorer {
 		EditorNode *editor;
 		EditorServer *server;
 		Vector<Variant> m_notificationParam;
+		String _get_unix_socket_path() const;
+		void _update_timeouts();
 	protected:
 		void _notification(int p_what);
 		static void _bind_methods();
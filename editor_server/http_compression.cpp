@@ -0,0 +1,269 @@
+#include "http_compression.h"
+#include <core/os/os.h>
+#include <zlib.h>
+#include "memory_budget.h"
+
+namespace gdexplorer {
+
+	HTTPEncoding http_choose_encoding(const String &p_accept_encoding) {
+		HTTPEncoding best = HTTP_ENCODING_IDENTITY;
+		float best_q = 0;
+		Vector<String> codings = p_accept_encoding.split(",");
+		for (int i = 0; i < codings.size(); i++) {
+			Vector<String> params = codings[i].split(";");
+			String name = params[0].strip_edges().to_lower();
+			float q = 1;
+			for (int j = 1; j < params.size(); j++) {
+				String param = params[j].strip_edges();
+				if (param.begins_with("q="))
+					q = param.substr(2, param.length() - 2).to_double();
+			}
+			HTTPEncoding encoding;
+			if (name == "gzip" || name == "x-gzip" || name == "*")
+				encoding = HTTP_ENCODING_GZIP;
+			else if (name == "deflate")
+				encoding = HTTP_ENCODING_DEFLATE;
+			else
+				continue;
+			// Ties go to gzip, some clients take deflate for raw deflate without the zlib header
+			if (q > best_q || (q == best_q && q > 0 && encoding == HTTP_ENCODING_GZIP)) {
+				best = encoding;
+				best_q = q;
+			}
+		}
+		return best;
+	}
+
+	const char* http_encoding_name(HTTPEncoding p_encoding) {
+		switch (p_encoding) {
+			case HTTP_ENCODING_GZIP: return "gzip";
+			case HTTP_ENCODING_DEFLATE: return "deflate";
+			default: return "identity";
+		}
+	}
+
+	Error HTTPDeflater::begin(HTTPEncoding p_encoding, int p_level) {
+		ERR_FAIL_COND_V(p_encoding == HTTP_ENCODING_IDENTITY, ERR_INVALID_PARAMETER);
+		end();
+		stream = memnew(z_stream);
+		stream->zalloc = Z_NULL;
+		stream->zfree = Z_NULL;
+		stream->opaque = Z_NULL;
+		// 15 window bits give zlib framing, adding 16 switches to a gzip header and trailer
+		int window_bits = p_encoding == HTTP_ENCODING_GZIP ? 15 + 16 : 15;
+		if (deflateInit2(stream, p_level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			memdelete(stream);
+			stream = nullptr;
+			return ERR_CANT_CREATE;
+		}
+		return OK;
+	}
+
+	Error HTTPDeflater::write(const uint8_t *p_data, int p_len, HTTPBuffer &r_out, bool p_finish) {
+		ERR_FAIL_COND_V(!stream, ERR_UNCONFIGURED);
+		stream->next_in = (Bytef*)p_data;
+		stream->avail_in = p_len;
+		int flush = p_finish ? Z_FINISH : Z_SYNC_FLUSH;
+		int ret;
+		do {
+			r_out.reserve(r_out.size() + MAX(int(deflateBound(stream, stream->avail_in)), 64));
+			int space = r_out.data.size() - r_out.used;
+			stream->next_out = r_out.data.ptr() + r_out.used;
+			stream->avail_out = space;
+			ret = deflate(stream, flush);
+			if (ret == Z_STREAM_ERROR)
+				return ERR_BUG;
+			r_out.used += space - stream->avail_out;
+		} while (stream->avail_out == 0 || (p_finish && ret != Z_STREAM_END));
+		return OK;
+	}
+
+	void HTTPDeflater::end() {
+		if (stream) {
+			deflateEnd(stream);
+			memdelete(stream);
+			stream = nullptr;
+		}
+	}
+
+	Mutex *HTTPCompression::mutex = nullptr;
+	Map<String, HTTPCompression::Entry> HTTPCompression::cache;
+	List<String> HTTPCompression::lru;
+	int HTTPCompression::cache_bytes = 0;
+	uint64_t HTTPCompression::compressed = 0;
+	uint64_t HTTPCompression::cache_hits = 0;
+	uint64_t HTTPCompression::not_smaller = 0;
+	uint64_t HTTPCompression::raw_bytes = 0;
+	uint64_t HTTPCompression::encoded_bytes = 0;
+	uint64_t HTTPCompression::compress_usec = 0;
+
+	namespace {
+		class CompressedResponsesMemory : public MemoryBudget::Consumer {
+		public:
+			virtual int64_t get_memory_usage() const override { return HTTPCompression::get_memory_usage(); }
+			virtual uint64_t get_oldest_use() const override { return HTTPCompression::get_oldest_use(); }
+			virtual int64_t evict_oldest() override { return HTTPCompression::evict_oldest(); }
+		};
+		CompressedResponsesMemory _memory_consumer;
+	}
+
+	void HTTPCompression::initialize() {
+		if (!mutex) {
+			mutex = Mutex::create();
+			MemoryBudget::add("compressed_responses", &_memory_consumer);
+		}
+	}
+
+	void HTTPCompression::finalize() {
+		if (mutex) {
+			MemoryBudget::remove(&_memory_consumer);
+			cache.clear();
+			lru.clear();
+			cache_bytes = 0;
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	int HTTPCompression::_erase_oldest() {
+		if (!lru.front())
+			return 0;
+		Map<String, Entry>::Element *oldest = cache.find(lru.front()->get());
+		int freed = oldest->get().body.size();
+		cache_bytes -= freed;
+		lru.pop_front();
+		cache.erase(oldest);
+		// Entries remembering a body that does not get smaller hold nothing, still report them as freed
+		return MAX(freed, 1);
+	}
+
+	bool HTTPCompression::encode(HTTPEncoding p_encoding, const String &p_etag, const uint8_t *p_body, int p_len, Vector<uint8_t> &r_encoded) {
+		ERR_FAIL_COND_V(!mutex, false);
+		String key;
+		if (!p_etag.empty()) {
+			key = p_etag + http_encoding_name(p_encoding);
+			mutex->lock();
+			Map<String, Entry>::Element *E = cache.find(key);
+			if (E) {
+				E->get().last_used = MemoryBudget::tick();
+				lru.move_to_back(E->get().lru);
+				// An empty body remembers that this one does not get smaller
+				bool smaller = E->get().body.size() > 0;
+				if (smaller) {
+					r_encoded = E->get().body;
+					cache_hits++;
+					raw_bytes += p_len;
+					encoded_bytes += r_encoded.size();
+				} else {
+					not_smaller++;
+				}
+				mutex->unlock();
+				return smaller;
+			}
+			mutex->unlock();
+		}
+
+		uint64_t begin = OS::get_singleton()->get_ticks_usec();
+		HTTPDeflater deflater;
+		// Cached bodies are compressed once and served many times, the others have to be fast
+		if (deflater.begin(p_encoding, key.empty() ? HTTPDeflater::LEVEL_FASTEST : HTTPDeflater::LEVEL_DEFAULT) != OK)
+			return false;
+		HTTPBuffer out;
+		if (deflater.write(p_body, p_len, out, true) != OK)
+			return false;
+		uint64_t usec = OS::get_singleton()->get_ticks_usec() - begin;
+
+		bool smaller = out.size() < p_len;
+		mutex->lock();
+		compress_usec += usec;
+		if (smaller) {
+			compressed++;
+			raw_bytes += p_len;
+			encoded_bytes += out.size();
+		} else {
+			not_smaller++;
+		}
+		mutex->unlock();
+
+		if (smaller) {
+			out.data.resize(out.size());
+			r_encoded = out.data;
+		}
+		if (!key.empty()) {
+			mutex->lock();
+			Entry& entry = cache[key];
+			cache_bytes += (smaller ? r_encoded.size() : 0) - entry.body.size();
+			entry.body = smaller ? r_encoded : Vector<uint8_t>();
+			entry.last_used = MemoryBudget::tick();
+			if (entry.lru)
+				lru.move_to_back(entry.lru);
+			else
+				entry.lru = lru.push_back(key);
+			while (cache_bytes > MAX_CACHE_BYTES && cache.size())
+				_erase_oldest();
+			mutex->unlock();
+			MemoryBudget::enforce();
+		}
+		return smaller;
+	}
+
+	void HTTPCompression::record(int p_raw_bytes, int p_encoded_bytes, uint64_t p_usec) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		compressed++;
+		raw_bytes += p_raw_bytes;
+		encoded_bytes += p_encoded_bytes;
+		compress_usec += p_usec;
+		mutex->unlock();
+	}
+
+	void HTTPCompression::clear_cache() {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		cache.clear();
+		lru.clear();
+		cache_bytes = 0;
+		mutex->unlock();
+	}
+
+	int64_t HTTPCompression::get_memory_usage() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		int64_t bytes = cache_bytes;
+		mutex->unlock();
+		return bytes;
+	}
+
+	uint64_t HTTPCompression::get_oldest_use() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		uint64_t oldest = lru.front() ? cache[lru.front()->get()].last_used : 0;
+		mutex->unlock();
+		return oldest;
+	}
+
+	int64_t HTTPCompression::evict_oldest() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		int64_t freed = _erase_oldest();
+		mutex->unlock();
+		return freed;
+	}
+
+	Dictionary HTTPCompression::get_stats() {
+		Dictionary stats;
+		ERR_FAIL_COND_V(!mutex, stats);
+		mutex->lock();
+		// Counts go to Variant as reals, an int is too small for long sessions
+		stats["compressed"] = double(compressed);
+		stats["cache_hits"] = double(cache_hits);
+		stats["not_smaller"] = double(not_smaller);
+		stats["raw_bytes"] = double(raw_bytes);
+		stats["encoded_bytes"] = double(encoded_bytes);
+		stats["compress_usec"] = double(compress_usec);
+		stats["cached_bytes"] = cache_bytes;
+		mutex->unlock();
+		return stats;
+	}
+
+}
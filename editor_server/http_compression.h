@@ -0,0 +1,90 @@
+#ifndef GD_EXPLORER_HTTP_COMPRESSION_H
+#define GD_EXPLORER_HTTP_COMPRESSION_H
+
+#include <core/ustring.h>
+#include <core/dictionary.h>
+#include <core/os/mutex.h>
+#include "http_protocol.h"
+
+struct z_stream_s;
+
+namespace gdexplorer {
+
+	enum HTTPEncoding {
+		HTTP_ENCODING_IDENTITY,
+		HTTP_ENCODING_GZIP,
+		HTTP_ENCODING_DEFLATE,
+	};
+
+	// Preferred content coding of an Accept-Encoding field value, identity when none of ours is acceptable
+	HTTPEncoding http_choose_encoding(const String& p_accept_encoding);
+	const char* http_encoding_name(HTTPEncoding p_encoding);
+
+	// Streaming deflate with gzip or zlib framing
+	class HTTPDeflater {
+		z_stream_s* stream = nullptr;
+	public:
+		// zlib compression levels
+		enum Level {
+			LEVEL_FASTEST = 1,
+			LEVEL_DEFAULT = 6,
+		};
+
+		Error begin(HTTPEncoding p_encoding, int p_level);
+		// Appends the compressed form of p_data to r_out. Without p_finish the output is flushed
+		// to a byte boundary, so the client can decode everything written so far
+		Error write(const uint8_t* p_data, int p_len, HTTPBuffer& r_out, bool p_finish);
+		void end();
+		~HTTPDeflater() { end(); }
+	};
+
+	// Compressed bodies of responses that carry an ETag, and the numbers that tell whether compression pays off
+	class HTTPCompression {
+	public:
+		enum {
+			// Least recently used bodies are dropped beyond this
+			MAX_CACHE_BYTES = 16 * 1024 * 1024,
+		};
+
+	private:
+		struct Entry {
+			Vector<uint8_t> body;
+			uint64_t last_used = 0;
+			List<String>::Element* lru = nullptr;
+		};
+
+		static Mutex *mutex;
+		static Map<String, Entry> cache;
+		// Keys from least to most recently used
+		static List<String> lru;
+		static int cache_bytes;
+		static uint64_t compressed;
+		static uint64_t cache_hits;
+		static uint64_t not_smaller;
+		static uint64_t raw_bytes;
+		static uint64_t encoded_bytes;
+		static uint64_t compress_usec;
+
+		static int _erase_oldest();
+	public:
+		static void initialize();
+		static void finalize();
+
+		// Compresses p_body as a whole, reusing the cached result for the same ETag.
+		// Returns false when the encoded form would not be smaller than the body
+		static bool encode(HTTPEncoding p_encoding, const String& p_etag, const uint8_t* p_body, int p_len, Vector<uint8_t>& r_encoded);
+		// Accounts a streamed response
+		static void record(int p_raw_bytes, int p_encoded_bytes, uint64_t p_usec);
+		static void clear_cache();
+
+		// Cached bodies for the memory budget
+		static int64_t get_memory_usage();
+		static uint64_t get_oldest_use();
+		static int64_t evict_oldest();
+
+		static Dictionary get_stats();
+	};
+
+}
+
+#endif // GD_EXPLORER_HTTP_COMPRESSION_H
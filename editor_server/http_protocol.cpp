@@ -0,0 +1,264 @@
+#include "http_protocol.h"
+#include "unix_socket.h"
+
+namespace gdexplorer {
+
+	static const char* _known_headers[HTTP_HEADER_MAX] = {
+		"content-length",
+		"connection",
+		"content-type",
+		"accept",
+		"accept-charset",
+		"allow",
+		"transfer-encoding",
+		"etag",
+		"if-none-match",
+		"accept-encoding",
+		"content-encoding",
+		"vary",
+	};
+
+	static const uint32_t _known_hashes[HTTP_HEADER_MAX] = {
+		http_header_hash("content-length"),
+		http_header_hash("connection"),
+		http_header_hash("content-type"),
+		http_header_hash("accept"),
+		http_header_hash("accept-charset"),
+		http_header_hash("allow"),
+		http_header_hash("transfer-encoding"),
+		http_header_hash("etag"),
+		http_header_hash("if-none-match"),
+		http_header_hash("accept-encoding"),
+		http_header_hash("content-encoding"),
+		http_header_hash("vary"),
+	};
+
+	static inline uint8_t _lower(uint8_t c) {
+		return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+	}
+
+	uint32_t http_header_hash(const uint8_t *p_str, int p_len) {
+		uint32_t hash = 2166136261u;
+		for (int i = 0; i < p_len; i++)
+			hash = (hash ^ uint32_t(_lower(p_str[i]))) * 16777619u;
+		return hash;
+	}
+
+	uint32_t http_header_hash(const String &p_name) {
+		CharString name = p_name.strip_edges().utf8();
+		return http_header_hash((const uint8_t*)name.get_data(), name.length());
+	}
+
+	const char* http_header_name(HTTPHeader p_header) {
+		ERR_FAIL_INDEX_V(p_header, HTTP_HEADER_MAX, "");
+		return _known_headers[p_header];
+	}
+
+	HTTPHeader http_header_find(const uint8_t *p_name, int p_len, uint32_t p_hash) {
+		for (int i = 0; i < HTTP_HEADER_MAX; i++) {
+			if (_known_hashes[i] != p_hash)
+				continue;
+			// Rule out hash collisions
+			const char* name = _known_headers[i];
+			int j = 0;
+			while (j < p_len && name[j] && _lower(p_name[j]) == uint8_t(name[j]))
+				j++;
+			if (j == p_len && !name[j])
+				return HTTPHeader(i);
+		}
+		return HTTP_HEADER_UNKNOWN;
+	}
+
+	void HTTPBuffer::reserve(int p_size) {
+		if (p_size <= data.size())
+			return;
+		int size = data.size() ? data.size() : 256;
+		// Doubling past half the int range would overflow, the exact size is taken instead
+		while (size < p_size)
+			size = size > INT32_MAX / 2 ? p_size : size << 1;
+		data.resize(size);
+	}
+
+	void HTTPBuffer::append(const uint8_t *p_data, int p_len) {
+		if (p_len <= 0)
+			return;
+		reserve(used + p_len);
+		copymem(&data[used], p_data, p_len);
+		used += p_len;
+	}
+
+	void HTTPBuffer::append(const char *p_str) {
+		int len = 0;
+		while (p_str[len])
+			len++;
+		append((const uint8_t*)p_str, len);
+	}
+
+	void HTTPBuffer::append(const String &p_str) {
+		CharString utf = p_str.utf8();
+		append((const uint8_t*)utf.get_data(), utf.length());
+	}
+
+	void HTTPBuffer::append_int(int64_t p_value) {
+		char digits[24];
+		int len = 0;
+		bool negative = p_value < 0;
+		uint64_t value = negative ? uint64_t(-p_value) : uint64_t(p_value);
+		do {
+			digits[len++] = '0' + char(value % 10);
+			value /= 10;
+		} while (value);
+		if (negative)
+			digits[len++] = '-';
+		reserve(used + len);
+		while (len)
+			data[used++] = digits[--len];
+	}
+
+	void HTTPBuffer::append_hex(uint32_t p_value) {
+		static const char* hex = "0123456789abcdef";
+		char digits[8];
+		int len = 0;
+		do {
+			digits[len++] = hex[p_value & 0xF];
+			p_value >>= 4;
+		} while (p_value);
+		reserve(used + len);
+		while (len)
+			data[used++] = digits[--len];
+	}
+
+	void HTTPHeaderTable::reset(const uint8_t *p_buffer, const Set<uint32_t> *p_wanted) {
+		buffer = p_buffer;
+		wanted = p_wanted;
+		for (int i = 0; i < HTTP_HEADER_MAX; i++)
+			known[i] = HTTPSpan();
+		extra_count = 0;
+	}
+
+	bool HTTPHeaderTable::add(const HTTPSpan &p_name, const HTTPSpan &p_value) {
+		const uint8_t* name = buffer + p_name.offset;
+		uint32_t hash = http_header_hash(name, p_name.length);
+		HTTPHeader header = http_header_find(name, p_name.length, hash);
+		if (header != HTTP_HEADER_UNKNOWN) {
+			known[header] = p_value;
+			return true;
+		}
+		if (!wanted || !wanted->has(hash) || extra_count >= MAX_EXTRA_FIELDS)
+			return false;
+		ExtraField& field = extra[extra_count++];
+		field.hash = hash;
+		field.name = p_name;
+		field.value = p_value;
+		return true;
+	}
+
+	String HTTPHeaderTable::_decode(const HTTPSpan &p_span) const {
+		String value;
+		if (p_span.valid() && p_span.length > 0)
+			value.parse_utf8((const char*)buffer + p_span.offset, p_span.length);
+		return value;
+	}
+
+	int HTTPHeaderTable::get_int(HTTPHeader p_header, int p_default) const {
+		const HTTPSpan& span = known[p_header];
+		if (!span.valid() || span.length == 0)
+			return p_default;
+		int value = 0;
+		for (int i = 0; i < span.length; i++) {
+			uint8_t c = buffer[span.offset + i];
+			if (c < '0' || c > '9')
+				return p_default;
+			// Values that do not fit an int are as malformed as letters
+			if (value > (INT32_MAX - (c - '0')) / 10)
+				return p_default;
+			value = value * 10 + (c - '0');
+		}
+		return value;
+	}
+
+	bool HTTPHeaderTable::equals(HTTPHeader p_header, const char *p_value) const {
+		const HTTPSpan& span = known[p_header];
+		if (!span.valid())
+			return false;
+		int i = 0;
+		for (; i < span.length && p_value[i]; i++) {
+			if (_lower(buffer[span.offset + i]) != _lower(uint8_t(p_value[i])))
+				return false;
+		}
+		return i == span.length && !p_value[i];
+	}
+
+	void HTTPResponseHeaders::set(const String &p_name, const String &p_value) {
+		CharString name = p_name.strip_edges().to_lower().utf8();
+		HTTPHeader header = http_header_find((const uint8_t*)name.get_data(), name.length(), http_header_hash((const uint8_t*)name.get_data(), name.length()));
+		if (header != HTTP_HEADER_UNKNOWN) {
+			known[header] = p_value.strip_edges();
+			return;
+		}
+		String lname = p_name.strip_edges().to_lower();
+		for (int i = 0; i < custom_count; i++) {
+			if (custom_names[i] == lname) {
+				custom_values[i] = p_value.strip_edges();
+				return;
+			}
+		}
+		ERR_FAIL_COND(custom_count >= MAX_CUSTOM_FIELDS);
+		custom_names[custom_count] = lname;
+		custom_values[custom_count] = p_value.strip_edges();
+		custom_count++;
+	}
+
+	void HTTPResponseHeaders::write(HTTPBuffer &r_buffer) const {
+		for (int i = 0; i < HTTP_HEADER_MAX; i++) {
+			if (known[i].empty())
+				continue;
+			r_buffer.append(_known_headers[i]);
+			r_buffer.append(": ");
+			r_buffer.append(known[i]);
+			r_buffer.append("\r\n");
+		}
+		for (int i = 0; i < custom_count; i++) {
+			r_buffer.append(custom_names[i]);
+			r_buffer.append(": ");
+			r_buffer.append(custom_values[i]);
+			r_buffer.append("\r\n");
+		}
+	}
+
+	// Below this size copying the body is cheaper than a second TCP segment on the wire
+	static const int GATHER_COPY_LIMIT = 8192;
+
+	static String _strip_weak(const String& p_tag) {
+		return p_tag.begins_with("W/") ? p_tag.substr(2, p_tag.length() - 2) : p_tag;
+	}
+
+	bool http_etag_matches(const String &p_if_none_match, const String &p_etag) {
+		if (p_etag.empty())
+			return false;
+		String etag = _strip_weak(p_etag);
+		Vector<String> tags = p_if_none_match.split(",");
+		for (int i = 0; i < tags.size(); i++) {
+			String tag = tags[i].strip_edges();
+			if (tag == "*" || _strip_weak(tag) == etag)
+				return true;
+		}
+		return false;
+	}
+
+	Error http_send_gather(const Ref<StreamPeer> &p_peer, HTTPBuffer &p_head, const uint8_t *p_body, int p_body_len) {
+		ERR_FAIL_COND_V(p_peer.is_null(), ERR_INVALID_PARAMETER);
+		StreamPeerUnix* local = p_peer->cast_to<StreamPeerUnix>();
+		if (local)
+			return local->put_data_gather(p_head.ptr(), p_head.size(), p_body, p_body_len);
+		if (p_body_len > 0 && p_body_len <= GATHER_COPY_LIMIT) {
+			p_head.append(p_body, p_body_len);
+			p_body_len = 0;
+		}
+		Error err = p_peer->put_data(p_head.ptr(), p_head.size());
+		if (err == OK && p_body_len > 0)
+			err = p_peer->put_data(p_body, p_body_len);
+		return err;
+	}
+
+}
@@ -0,0 +1,136 @@
+#ifndef GD_EXPLORER_HTTP_PROTOCOL_H
+#define GD_EXPLORER_HTTP_PROTOCOL_H
+
+#include <core/ustring.h>
+#include <core/vector.h>
+#include <core/set.h>
+#include <core/io/stream_peer.h>
+
+namespace gdexplorer {
+
+	// Header fields the server itself understands, recognized without building a String
+	enum HTTPHeader {
+		HTTP_HEADER_UNKNOWN = -1,
+		HTTP_HEADER_CONTENT_LENGTH = 0,
+		HTTP_HEADER_CONNECTION,
+		HTTP_HEADER_CONTENT_TYPE,
+		HTTP_HEADER_ACCEPT,
+		HTTP_HEADER_ACCEPT_CHARSET,
+		HTTP_HEADER_ALLOW,
+		HTTP_HEADER_TRANSFER_ENCODING,
+		HTTP_HEADER_ETAG,
+		HTTP_HEADER_IF_NONE_MATCH,
+		HTTP_HEADER_ACCEPT_ENCODING,
+		HTTP_HEADER_CONTENT_ENCODING,
+		HTTP_HEADER_VARY,
+		HTTP_HEADER_MAX
+	};
+
+	// Case insensitive FNV-1a, usable at compile time for the known field names
+	constexpr uint32_t http_header_hash(const char* p_str, uint32_t p_hash = 2166136261u) {
+		return *p_str ? http_header_hash(p_str + 1, (p_hash ^ uint32_t((*p_str >= 'A' && *p_str <= 'Z') ? *p_str + ('a' - 'A') : *p_str)) * 16777619u) : p_hash;
+	}
+	uint32_t http_header_hash(const uint8_t* p_str, int p_len);
+	uint32_t http_header_hash(const String& p_name);
+
+	// Lower case wire name of a known header
+	const char* http_header_name(HTTPHeader p_header);
+	HTTPHeader http_header_find(const uint8_t* p_name, int p_len, uint32_t p_hash);
+
+	// Growable byte buffer that keeps its capacity between requests
+	struct HTTPBuffer {
+		Vector<uint8_t> data;
+		int used = 0;
+
+		void clear() { used = 0; }
+		void reserve(int p_size);
+		void push_back(uint8_t p_byte) {
+			if (used >= data.size())
+				reserve(used + 1);
+			data[used++] = p_byte;
+		}
+		void append(const uint8_t* p_data, int p_len);
+		void append(const char* p_str);
+		void append(const String& p_str);
+		void append_int(int64_t p_value);
+		void append_hex(uint32_t p_value);
+		const uint8_t* ptr() const { return data.ptr(); }
+		int size() const { return used; }
+		int capacity() const { return data.size(); }
+		// Frees the storage once it grew beyond p_capacity, the contents are dropped with it
+		void trim(int p_capacity) {
+			if (data.size() > p_capacity) {
+				data = Vector<uint8_t>();
+				used = 0;
+			}
+		}
+	};
+
+	// View into the read buffer of a connection
+	struct HTTPSpan {
+		int offset = 0;
+		int length = -1;
+		bool valid() const { return length >= 0; }
+	};
+
+	// Request header fields as spans into the read buffer, nothing is copied until a value is asked for
+	class HTTPHeaderTable {
+	public:
+		enum { MAX_EXTRA_FIELDS = 16 };
+	private:
+		struct ExtraField {
+			uint32_t hash;
+			HTTPSpan name;
+			HTTPSpan value;
+		};
+		const uint8_t* buffer = nullptr;
+		const Set<uint32_t>* wanted = nullptr;
+		HTTPSpan known[HTTP_HEADER_MAX];
+		ExtraField extra[MAX_EXTRA_FIELDS];
+		int extra_count = 0;
+
+		String _decode(const HTTPSpan& p_span) const;
+	public:
+		void reset(const uint8_t* p_buffer, const Set<uint32_t>* p_wanted);
+		// Returns false when the field is not known and nobody asked for it
+		bool add(const HTTPSpan& p_name, const HTTPSpan& p_value);
+
+		bool has(HTTPHeader p_header) const { return known[p_header].valid(); }
+		String get(HTTPHeader p_header) const { return _decode(known[p_header]); }
+		// p_default when the field is missing, not a plain decimal or larger than an int
+		int get_int(HTTPHeader p_header, int p_default = 0) const;
+		bool equals(HTTPHeader p_header, const char* p_value) const;
+
+		int get_extra_count() const { return extra_count; }
+		String get_extra_name(int p_idx) const { return _decode(extra[p_idx].name); }
+		String get_extra_value(int p_idx) const { return _decode(extra[p_idx].value); }
+	};
+
+	// Response fields, known headers first and a few custom ones
+	class HTTPResponseHeaders {
+	public:
+		enum { MAX_CUSTOM_FIELDS = 8 };
+	private:
+		String known[HTTP_HEADER_MAX];
+		String custom_names[MAX_CUSTOM_FIELDS];
+		String custom_values[MAX_CUSTOM_FIELDS];
+		int custom_count = 0;
+	public:
+		void set(HTTPHeader p_header, const String& p_value) { known[p_header] = p_value; }
+		void set(const String& p_name, const String& p_value);
+		bool has(HTTPHeader p_header) const { return !known[p_header].empty(); }
+		String get(HTTPHeader p_header) const { return known[p_header]; }
+		void write(HTTPBuffer& r_buffer) const;
+	};
+
+	// Whether an If-None-Match field value, a list of tags or "*", names p_etag. Weak tags compare equal to strong ones
+	bool http_etag_matches(const String& p_if_none_match, const String& p_etag);
+
+	// Writes an encoded header block and a body as one logical write.
+	// Unix domain sockets get a real vectored write. On TCP small bodies are gathered into the
+	// header buffer and large ones are sent right after it without copying
+	Error http_send_gather(const Ref<StreamPeer>& p_peer, HTTPBuffer& p_head, const uint8_t* p_body, int p_body_len);
+
+}
+
+#endif // GD_EXPLORER_HTTP_PROTOCOL_H
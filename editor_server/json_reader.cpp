@@ -0,0 +1,313 @@
+#include "json_reader.h"
+#include "json_writer.h"
+#include <string.h>
+
+namespace gdexplorer {
+
+	static inline int _skip_space(const uint8_t* p_data, int p_pos, int p_len) {
+		while (p_pos < p_len && (p_data[p_pos] == ' ' || p_data[p_pos] == '\t' || p_data[p_pos] == '\r' || p_data[p_pos] == '\n'))
+			p_pos++;
+		return p_pos;
+	}
+
+	// p_pos is on the opening quote, returns the position after the closing one or -1
+	static int _skip_string(const uint8_t* p_data, int p_pos, int p_len) {
+		for (int i = p_pos + 1; i < p_len; i++) {
+			if (p_data[i] == '\\')
+				i++;
+			else if (p_data[i] == '"')
+				return i + 1;
+			else if (p_data[i] < 0x20)
+				return -1;
+		}
+		return -1;
+	}
+
+	// p_pos is on the first character of a number, returns the position after it or -1
+	static int _skip_number(const uint8_t* p_data, int p_pos, int p_len) {
+		int i = p_pos;
+		if (i < p_len && p_data[i] == '-')
+			i++;
+		int digits = i;
+		while (i < p_len && p_data[i] >= '0' && p_data[i] <= '9')
+			i++;
+		if (i == digits)
+			return -1;
+		if (i < p_len && p_data[i] == '.') {
+			int fraction = ++i;
+			while (i < p_len && p_data[i] >= '0' && p_data[i] <= '9')
+				i++;
+			if (i == fraction)
+				return -1;
+		}
+		if (i < p_len && (p_data[i] == 'e' || p_data[i] == 'E')) {
+			i++;
+			if (i < p_len && (p_data[i] == '+' || p_data[i] == '-'))
+				i++;
+			int exponent = i;
+			while (i < p_len && p_data[i] >= '0' && p_data[i] <= '9')
+				i++;
+			if (i == exponent)
+				return -1;
+		}
+		return i;
+	}
+
+	static bool _matches(const uint8_t* p_data, int p_pos, int p_len, const char* p_literal) {
+		int len = strlen(p_literal);
+		return p_pos + len <= p_len && memcmp(p_data + p_pos, p_literal, len) == 0;
+	}
+
+	// Values are validated as they are skipped, write_fields() copies them to the response verbatim
+	static int _skip_value(const uint8_t* p_data, int p_pos, int p_len, int p_depth = 0) {
+		if (p_pos >= p_len || p_depth > JSONObjectView::MAX_DEPTH)
+			return -1;
+		uint8_t c = p_data[p_pos];
+		if (c == '"')
+			return _skip_string(p_data, p_pos, p_len);
+		if (c == '{' || c == '[') {
+			uint8_t close = c == '{' ? '}' : ']';
+			int i = _skip_space(p_data, p_pos + 1, p_len);
+			if (i < p_len && p_data[i] == close)
+				return i + 1;
+			while (i < p_len) {
+				if (c == '{') {
+					if (p_data[i] != '"')
+						return -1;
+					i = _skip_string(p_data, i, p_len);
+					if (i < 0)
+						return -1;
+					i = _skip_space(p_data, i, p_len);
+					if (i >= p_len || p_data[i] != ':')
+						return -1;
+					i = _skip_space(p_data, i + 1, p_len);
+				}
+				i = _skip_value(p_data, i, p_len, p_depth + 1);
+				if (i < 0)
+					return -1;
+				i = _skip_space(p_data, i, p_len);
+				if (i >= p_len)
+					return -1;
+				if (p_data[i] == close)
+					return i + 1;
+				if (p_data[i] != ',')
+					return -1;
+				i = _skip_space(p_data, i + 1, p_len);
+			}
+			return -1;
+		}
+		if (_matches(p_data, p_pos, p_len, "true"))
+			return p_pos + 4;
+		if (_matches(p_data, p_pos, p_len, "false"))
+			return p_pos + 5;
+		if (_matches(p_data, p_pos, p_len, "null"))
+			return p_pos + 4;
+		return _skip_number(p_data, p_pos, p_len);
+	}
+
+	static void _append_utf8(CharString& r_utf8, uint32_t p_code) {
+		if (p_code < 0x80) {
+			r_utf8.push_back(p_code);
+		} else if (p_code < 0x800) {
+			r_utf8.push_back(0xC0 | (p_code >> 6));
+			r_utf8.push_back(0x80 | (p_code & 0x3F));
+		} else {
+			r_utf8.push_back(0xE0 | (p_code >> 12));
+			r_utf8.push_back(0x80 | ((p_code >> 6) & 0x3F));
+			r_utf8.push_back(0x80 | (p_code & 0x3F));
+		}
+	}
+
+	bool JSONObjectView::parse(const uint8_t *p_data, int p_len) {
+		data = p_data;
+		count = 0;
+		if (_parse(p_data, p_len))
+			return true;
+		count = 0;
+		return false;
+	}
+
+	bool JSONObjectView::_parse(const uint8_t *p_data, int p_len) {
+		int pos = _skip_space(p_data, 0, p_len);
+		if (pos >= p_len || p_data[pos] != '{')
+			return false;
+		pos = _skip_space(p_data, pos + 1, p_len);
+		// Anything but whitespace after the object makes the body malformed, as it does for JSON::parse()
+		if (pos < p_len && p_data[pos] == '}')
+			return _skip_space(p_data, pos + 1, p_len) == p_len;
+		while (pos < p_len) {
+			if (p_data[pos] != '"' || count >= MAX_FIELDS)
+				return false;
+			int key_end = _skip_string(p_data, pos, p_len);
+			if (key_end < 0)
+				return false;
+			Field& f = fields[count];
+			f.key.offset = pos + 1;
+			f.key.length = key_end - pos - 2;
+			pos = _skip_space(p_data, key_end, p_len);
+			if (pos >= p_len || p_data[pos] != ':')
+				return false;
+			pos = _skip_space(p_data, pos + 1, p_len);
+			int value_end = _skip_value(p_data, pos, p_len);
+			if (value_end < 0)
+				return false;
+			f.value.offset = pos;
+			f.value.length = value_end - pos;
+			count++;
+			pos = _skip_space(p_data, value_end, p_len);
+			if (pos >= p_len)
+				return false;
+			if (p_data[pos] == '}')
+				return _skip_space(p_data, pos + 1, p_len) == p_len;
+			if (p_data[pos] != ',')
+				return false;
+			pos = _skip_space(p_data, pos + 1, p_len);
+		}
+		return false;
+	}
+
+	int JSONObjectView::_find(const char *p_key) const {
+		int len = strlen(p_key);
+		// The last of duplicate keys wins, like it does in the Dictionary JSON::parse() builds
+		for (int i = count - 1; i >= 0; i--) {
+			if (fields[i].key.length == len && memcmp(data + fields[i].key.offset, p_key, len) == 0)
+				return i;
+		}
+		return -1;
+	}
+
+	bool JSONObjectView::is_null(const char *p_key) const {
+		int idx = _find(p_key);
+		return idx < 0 || (fields[idx].value.length == 4 && memcmp(data + fields[idx].value.offset, "null", 4) == 0);
+	}
+
+	String JSONObjectView::get_string(const char *p_key, const String &p_default) const {
+		int idx = _find(p_key);
+		if (idx < 0 || data[fields[idx].value.offset] != '"')
+			return p_default;
+		const uint8_t* s = data + fields[idx].value.offset + 1;
+		int len = fields[idx].value.length - 2;
+		// Plain strings are decoded in one go, escaped ones are unescaped into UTF-8 first
+		if (!memchr(s, '\\', len)) {
+			String str;
+			str.parse_utf8((const char*)s, len);
+			return str;
+		}
+		CharString utf8;
+		for (int i = 0; i < len; i++) {
+			if (s[i] != '\\') {
+				utf8.push_back(s[i]);
+				continue;
+			}
+			if (++i >= len)
+				break;
+			switch (s[i]) {
+				case 'n': utf8.push_back('\n'); break;
+				case 't': utf8.push_back('\t'); break;
+				case 'r': utf8.push_back('\r'); break;
+				case 'b': utf8.push_back('\b'); break;
+				case 'f': utf8.push_back('\f'); break;
+				case 'u': {
+					if (i + 4 >= len)
+						break;
+					uint32_t code = 0;
+					for (int j = 1; j <= 4; j++) {
+						uint8_t h = s[i + j];
+						code <<= 4;
+						if (h >= '0' && h <= '9')
+							code |= h - '0';
+						else if (h >= 'a' && h <= 'f')
+							code |= h - 'a' + 10;
+						else if (h >= 'A' && h <= 'F')
+							code |= h - 'A' + 10;
+					}
+					_append_utf8(utf8, code);
+					i += 4;
+				} break;
+				default: utf8.push_back(s[i]); break;
+			}
+		}
+		String str;
+		str.parse_utf8(utf8.get_data(), utf8.length());
+		return str;
+	}
+
+	int64_t JSONObjectView::get_int(const char *p_key, int64_t p_default) const {
+		int idx = _find(p_key);
+		if (idx < 0)
+			return p_default;
+		const uint8_t* s = data + fields[idx].value.offset;
+		int len = fields[idx].value.length;
+		int i = 0;
+		bool negative = i < len && s[i] == '-';
+		if (negative)
+			i++;
+		if (i >= len || s[i] < '0' || s[i] > '9')
+			return p_default;
+		int64_t v = 0;
+		for (; i < len && s[i] >= '0' && s[i] <= '9'; i++) {
+			// Values that do not fit are as malformed as letters
+			if (v > (INT64_MAX - (s[i] - '0')) / 10)
+				return p_default;
+			v = v * 10 + (s[i] - '0');
+		}
+		if (i < len)
+			return int64_t(get_real(p_key, p_default));
+		return negative ? -v : v;
+	}
+
+	double JSONObjectView::get_real(const char *p_key, double p_default) const {
+		int idx = _find(p_key);
+		if (idx < 0)
+			return p_default;
+		uint8_t c = data[fields[idx].value.offset];
+		if (c != '-' && (c < '0' || c > '9'))
+			return p_default;
+		String number;
+		number.parse_utf8((const char*)data + fields[idx].value.offset, fields[idx].value.length);
+		return number.to_double();
+	}
+
+	bool JSONObjectView::get_bool(const char *p_key, bool p_default) const {
+		int idx = _find(p_key);
+		if (idx < 0)
+			return p_default;
+		const uint8_t* s = data + fields[idx].value.offset;
+		if (fields[idx].value.length == 4 && memcmp(s, "true", 4) == 0)
+			return true;
+		if (fields[idx].value.length == 5 && memcmp(s, "false", 5) == 0)
+			return false;
+		// Numbers count like they do for a Variant
+		return get_real(p_key, p_default ? 1 : 0) != 0;
+	}
+
+	bool JSONObjectView::get_object(const char *p_key, JSONObjectView &r_object) const {
+		int idx = _find(p_key);
+		if (idx < 0)
+			return false;
+		return r_object.parse(data + fields[idx].value.offset, fields[idx].value.length);
+	}
+
+	bool JSONObjectView::_same_key(int p_a, int p_b) const {
+		return fields[p_a].key.length == fields[p_b].key.length &&
+				memcmp(data + fields[p_a].key.offset, data + fields[p_b].key.offset, fields[p_a].key.length) == 0;
+	}
+
+	void JSONObjectView::write_fields(JSONWriter &p_writer, const char *p_skip) const {
+		int skip = p_skip ? _find(p_skip) : -1;
+		for (int i = 0; i < count; i++) {
+			const Field& f = fields[i];
+			if (skip >= 0 && _same_key(i, skip))
+				continue;
+			// Only the last of duplicate keys is echoed
+			bool replaced = false;
+			for (int j = i + 1; j < count && !replaced; j++)
+				replaced = _same_key(i, j);
+			if (replaced)
+				continue;
+			p_writer.raw_key(data + f.key.offset, f.key.length);
+			p_writer.raw(data + f.value.offset, f.value.length);
+		}
+	}
+
+}
@@ -0,0 +1,48 @@
+#ifndef GD_EXPLORER_JSON_READER_H
+#define GD_EXPLORER_JSON_READER_H
+
+#include <core/ustring.h>
+#include "http_protocol.h"
+
+namespace gdexplorer {
+
+	class JSONWriter;
+
+	// Fields of a JSON object as spans into the source text, values are only decoded when asked for
+	class JSONObjectView {
+	public:
+		enum { MAX_FIELDS = 32, MAX_DEPTH = 64 };
+	private:
+		struct Field {
+			// Key without its quotes, still escaped
+			HTTPSpan key;
+			HTTPSpan value;
+		};
+		const uint8_t* data = nullptr;
+		Field fields[MAX_FIELDS];
+		int count = 0;
+
+		bool _parse(const uint8_t* p_data, int p_len);
+		int _find(const char* p_key) const;
+		bool _same_key(int p_a, int p_b) const;
+	public:
+		// Returns false when the text is not a valid object, it has more than MAX_FIELDS fields,
+		// its values nest deeper than MAX_DEPTH or anything but whitespace follows it
+		bool parse(const uint8_t* p_data, int p_len);
+
+		int size() const { return count; }
+		bool has(const char* p_key) const { return _find(p_key) >= 0; }
+		bool is_null(const char* p_key) const;
+		String get_string(const char* p_key, const String& p_default = String()) const;
+		int64_t get_int(const char* p_key, int64_t p_default = 0) const;
+		double get_real(const char* p_key, double p_default = 0) const;
+		bool get_bool(const char* p_key, bool p_default = false) const;
+		bool get_object(const char* p_key, JSONObjectView& r_object) const;
+
+		// Copies every field but p_skip into the object open in p_writer, values stay encoded as they came
+		void write_fields(JSONWriter& p_writer, const char* p_skip = nullptr) const;
+	};
+
+}
+
+#endif // GD_EXPLORER_JSON_READER_H
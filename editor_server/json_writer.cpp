@@ -0,0 +1,260 @@
+#include "json_writer.h"
+
+namespace gdexplorer {
+
+	CharString JSONBufferSink::get_data() const {
+		CharString data;
+		data.resize(buffer.size() + 1);
+		if (buffer.size())
+			copymem(data.ptr(), buffer.ptr(), buffer.size());
+		data[buffer.size()] = 0;
+		return data;
+	}
+
+	JSONWriter::JSONWriter(JSONSink *p_sink, int p_flush_size): sink(p_sink), flush_size(p_flush_size) {
+		buffer.reserve(flush_size + 256);
+	}
+
+	JSONWriter::~JSONWriter() {
+		flush();
+	}
+
+	Error JSONWriter::flush() {
+		if (buffer.size() && error == OK)
+			error = sink->write(buffer.ptr(), buffer.size());
+		buffer.clear();
+		return error;
+	}
+
+	void JSONWriter::_separate() {
+		if (after_key) {
+			after_key = false;
+			return;
+		}
+		if (depth > 0) {
+			if (has_items[depth-1])
+				buffer.push_back(',');
+			has_items[depth-1] = true;
+		}
+	}
+
+	void JSONWriter::_write_string(const uint8_t *p_str, int p_len) {
+		static const char* hex = "0123456789abcdef";
+		buffer.push_back('"');
+		int run = 0;
+		for (int i = 0; i < p_len; i++) {
+			uint8_t c = p_str[i];
+			if (c >= 0x20 && c != '"' && c != '\\')
+				continue;
+			buffer.append(p_str + run, i - run);
+			run = i + 1;
+			buffer.push_back('\\');
+			switch (c) {
+				case '"': buffer.push_back('"'); break;
+				case '\\': buffer.push_back('\\'); break;
+				case '\n': buffer.push_back('n'); break;
+				case '\r': buffer.push_back('r'); break;
+				case '\t': buffer.push_back('t'); break;
+				case '\b': buffer.push_back('b'); break;
+				case '\f': buffer.push_back('f'); break;
+				default: {
+					buffer.append("u00");
+					buffer.push_back(hex[c >> 4]);
+					buffer.push_back(hex[c & 0xF]);
+				} break;
+			}
+		}
+		buffer.append(p_str + run, p_len - run);
+		buffer.push_back('"');
+		_maybe_flush();
+	}
+
+	bool JSONWriter::_begin_nested() {
+		if (dropped) {
+			dropped++;
+			return false;
+		}
+		_separate();
+		if (depth >= MAX_DEPTH) {
+			// The value still takes its place, so the output stays balanced JSON
+			ERR_PRINT("JSON nested deeper than MAX_DEPTH");
+			buffer.append("null");
+			dropped = 1;
+			return false;
+		}
+		has_items[depth++] = false;
+		return true;
+	}
+
+	bool JSONWriter::_end_nested() {
+		if (dropped) {
+			dropped--;
+			return false;
+		}
+		ERR_FAIL_COND_V(depth <= 0, false);
+		depth--;
+		return true;
+	}
+
+	void JSONWriter::begin_object() {
+		if (_begin_nested())
+			buffer.push_back('{');
+	}
+
+	void JSONWriter::end_object() {
+		if (!_end_nested())
+			return;
+		buffer.push_back('}');
+		_maybe_flush();
+	}
+
+	void JSONWriter::begin_array() {
+		if (_begin_nested())
+			buffer.push_back('[');
+	}
+
+	void JSONWriter::end_array() {
+		if (!_end_nested())
+			return;
+		buffer.push_back(']');
+		_maybe_flush();
+	}
+
+	void JSONWriter::key(const char *p_key) {
+		if (dropped)
+			return;
+		_separate();
+		int len = 0;
+		while (p_key[len])
+			len++;
+		_write_string((const uint8_t*)p_key, len);
+		buffer.push_back(':');
+		after_key = true;
+	}
+
+	void JSONWriter::key(const String &p_key) {
+		if (dropped)
+			return;
+		_separate();
+		CharString utf = p_key.utf8();
+		_write_string((const uint8_t*)utf.get_data(), utf.length());
+		buffer.push_back(':');
+		after_key = true;
+	}
+
+	void JSONWriter::raw_key(const uint8_t *p_key, int p_len) {
+		if (dropped)
+			return;
+		_separate();
+		buffer.push_back('"');
+		buffer.append(p_key, p_len);
+		buffer.push_back('"');
+		buffer.push_back(':');
+		after_key = true;
+	}
+
+	void JSONWriter::value(const String &p_value) {
+		if (dropped)
+			return;
+		_separate();
+		CharString utf = p_value.utf8();
+		_write_string((const uint8_t*)utf.get_data(), utf.length());
+	}
+
+	void JSONWriter::value(const char *p_value) {
+		if (dropped)
+			return;
+		_separate();
+		int len = 0;
+		while (p_value[len])
+			len++;
+		_write_string((const uint8_t*)p_value, len);
+	}
+
+	void JSONWriter::value(int64_t p_value) {
+		if (dropped)
+			return;
+		_separate();
+		buffer.append_int(p_value);
+		_maybe_flush();
+	}
+
+	void JSONWriter::value(double p_value) {
+		if (dropped)
+			return;
+		_separate();
+		buffer.append(String::num_real(p_value));
+		_maybe_flush();
+	}
+
+	void JSONWriter::value(bool p_value) {
+		if (dropped)
+			return;
+		_separate();
+		buffer.append(p_value ? "true" : "false");
+		_maybe_flush();
+	}
+
+	void JSONWriter::null() {
+		if (dropped)
+			return;
+		_separate();
+		buffer.append("null");
+		_maybe_flush();
+	}
+
+	void JSONWriter::raw(const uint8_t *p_json, int p_len) {
+		if (dropped)
+			return;
+		_separate();
+		if (p_len >= flush_size) {
+			// Big fragments go straight to the sink
+			flush();
+			if (error == OK)
+				error = sink->write(p_json, p_len);
+			return;
+		}
+		buffer.append(p_json, p_len);
+		_maybe_flush();
+	}
+
+	void JSONWriter::value(const Variant &p_value) {
+		switch (p_value.get_type()) {
+			case Variant::NIL: {
+				null();
+			} break;
+			case Variant::BOOL: {
+				value(bool(p_value));
+			} break;
+			case Variant::INT: {
+				value(int64_t(p_value));
+			} break;
+			case Variant::REAL: {
+				value(double(p_value));
+			} break;
+			case Variant::DICTIONARY: {
+				Dictionary d = p_value;
+				List<Variant> keys;
+				d.get_key_list(&keys);
+				begin_object();
+				for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+					key(String(E->get()));
+					value(d[E->get()]);
+				}
+				end_object();
+			} break;
+			default: {
+				if (p_value.is_array()) {
+					Array a = p_value;
+					begin_array();
+					for (int i = 0; i < a.size(); i++)
+						value(a[i]);
+					end_array();
+				} else {
+					value(String(p_value));
+				}
+			} break;
+		}
+	}
+
+}
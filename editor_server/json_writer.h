@@ -0,0 +1,93 @@
+#ifndef GD_EXPLORER_JSON_WRITER_H
+#define GD_EXPLORER_JSON_WRITER_H
+
+#include <core/variant.h>
+#include <core/os/file_access.h>
+#include "http_protocol.h"
+
+namespace gdexplorer {
+
+	// Destination of serialized JSON bytes
+	class JSONSink {
+	public:
+		virtual Error write(const uint8_t* p_data, int p_len) = 0;
+		virtual ~JSONSink() {}
+	};
+
+	// Collects the output in memory, used for fragments that are cached or embedded later
+	class JSONBufferSink : public JSONSink {
+		HTTPBuffer buffer;
+	public:
+		virtual Error write(const uint8_t* p_data, int p_len) override {
+			buffer.append(p_data, p_len);
+			return OK;
+		}
+		const uint8_t* ptr() const { return buffer.ptr(); }
+		int size() const { return buffer.size(); }
+		CharString get_data() const;
+	};
+
+	class JSONFileSink : public JSONSink {
+		FileAccess* file;
+	public:
+		virtual Error write(const uint8_t* p_data, int p_len) override {
+			file->store_buffer(p_data, p_len);
+			return file->get_error();
+		}
+		JSONFileSink(FileAccess* p_file): file(p_file) {}
+	};
+
+	// Incremental JSON serializer, buffers at most flush_size bytes before handing them to the sink
+	class JSONWriter {
+		enum { MAX_DEPTH = 64 };
+		JSONSink* sink;
+		HTTPBuffer buffer;
+		int flush_size;
+		bool has_items[MAX_DEPTH];
+		int depth = 0;
+		// Levels past MAX_DEPTH written as a single null, everything inside them is dropped
+		int dropped = 0;
+		bool after_key = false;
+		Error error = OK;
+
+		void _separate();
+		bool _begin_nested();
+		bool _end_nested();
+		void _write_string(const uint8_t* p_str, int p_len);
+		void _maybe_flush() {
+			if (buffer.size() >= flush_size)
+				flush();
+		}
+	public:
+		void begin_object();
+		void end_object();
+		void begin_array();
+		void end_array();
+
+		void key(const char* p_key);
+		void key(const String& p_key);
+		// Key that is already escaped, written between quotes as is
+		void raw_key(const uint8_t* p_key, int p_len);
+
+		void value(const String& p_value);
+		void value(const char* p_value);
+		void value(int64_t p_value);
+		void value(int p_value) { value(int64_t(p_value)); }
+		void value(double p_value);
+		void value(bool p_value);
+		void value(const Variant& p_value);
+		void null();
+		// Inserts an already serialized JSON value
+		void raw(const uint8_t* p_json, int p_len);
+		void raw(const CharString& p_json) { raw((const uint8_t*)p_json.get_data(), p_json.length()); }
+
+		Error flush();
+		Error get_error() const { return error; }
+
+		JSONWriter(JSONSink* p_sink, int p_flush_size = 16384);
+		~JSONWriter();
+	};
+
+}
+
+#endif // GD_EXPLORER_JSON_WRITER_H
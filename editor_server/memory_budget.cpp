@@ -0,0 +1,123 @@
+#include "memory_budget.h"
+
+namespace gdexplorer {
+
+	Mutex *MemoryBudget::mutex = nullptr;
+	Vector<MemoryBudget::Registration> MemoryBudget::consumers;
+	int64_t MemoryBudget::limit = 0;
+	uint64_t MemoryBudget::evictions = 0;
+	int64_t MemoryBudget::evicted_bytes = 0;
+
+	void MemoryBudget::initialize() {
+		if (!mutex)
+			mutex = Mutex::create();
+	}
+
+	void MemoryBudget::finalize() {
+		if (mutex) {
+			consumers.clear();
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	void MemoryBudget::add(const String &p_name, Consumer *p_consumer) {
+		// Services can be instanced without a server, nothing is tracked then
+		if (!mutex)
+			return;
+		Registration r;
+		r.name = p_name;
+		r.consumer = p_consumer;
+		mutex->lock();
+		consumers.push_back(r);
+		mutex->unlock();
+	}
+
+	void MemoryBudget::remove(Consumer *p_consumer) {
+		// Consumers may outlive the budget
+		if (!mutex)
+			return;
+		mutex->lock();
+		for (int i = 0; i < consumers.size(); i++) {
+			if (consumers[i].consumer == p_consumer) {
+				consumers.remove(i);
+				break;
+			}
+		}
+		mutex->unlock();
+	}
+
+	void MemoryBudget::set_limit(int64_t p_bytes) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		limit = MAX(p_bytes, 0);
+		mutex->unlock();
+		enforce();
+	}
+
+	int64_t MemoryBudget::get_limit() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		int64_t l = limit;
+		mutex->unlock();
+		return l;
+	}
+
+	void MemoryBudget::enforce() {
+		if (!mutex)
+			return;
+		mutex->lock();
+		if (!limit) {
+			mutex->unlock();
+			return;
+		}
+		int64_t total = 0;
+		for (int i = 0; i < consumers.size(); i++)
+			total += consumers[i].consumer->get_memory_usage();
+		while (total > limit) {
+			Consumer* oldest = nullptr;
+			uint64_t oldest_use = 0;
+			for (int i = 0; i < consumers.size(); i++) {
+				uint64_t use = consumers[i].consumer->get_oldest_use();
+				if (use && (!oldest || use < oldest_use)) {
+					oldest = consumers[i].consumer;
+					oldest_use = use;
+				}
+			}
+			// What is left can not be evicted, like indexes and connection buffers
+			if (!oldest)
+				break;
+			int64_t freed = oldest->evict_oldest();
+			if (freed <= 0)
+				break;
+			evictions++;
+			evicted_bytes += freed;
+			total -= freed;
+		}
+		mutex->unlock();
+	}
+
+	Dictionary MemoryBudget::get_report() {
+		Dictionary report;
+		ERR_FAIL_COND_V(!mutex, report);
+		Dictionary components;
+		int64_t total = 0;
+		mutex->lock();
+		for (int i = 0; i < consumers.size(); i++) {
+			int64_t bytes = consumers[i].consumer->get_memory_usage();
+			// Several instances of one component add up
+			double previous = components.has(consumers[i].name) ? double(components[consumers[i].name]) : 0.0;
+			components[consumers[i].name] = previous + double(bytes);
+			total += bytes;
+		}
+		// Byte counts go to Variant as reals, an int is too small
+		report["limit"] = double(limit);
+		report["total"] = double(total);
+		report["evictions"] = double(evictions);
+		report["evicted_bytes"] = double(evicted_bytes);
+		mutex->unlock();
+		report["components"] = components;
+		return report;
+	}
+
+}
@@ -0,0 +1,63 @@
+#ifndef GD_EXPLORER_MEMORY_BUDGET_H
+#define GD_EXPLORER_MEMORY_BUDGET_H
+
+#include <core/ustring.h>
+#include <core/dictionary.h>
+#include <core/os/os.h>
+#include <core/os/mutex.h>
+
+namespace gdexplorer {
+
+	// Caps what the server's caches and buffers hold inside the editor process.
+	// Components register as consumers, the least recently used entries go first whichever component holds them
+	class MemoryBudget {
+	public:
+		class Consumer {
+		public:
+			// Estimated from the sizes of what is stored, kept as a running count so asking is cheap
+			virtual int64_t get_memory_usage() const = 0;
+			// Last use of the entry evict_oldest() would drop, 0 when nothing can be dropped
+			virtual uint64_t get_oldest_use() const { return 0; }
+			// Returns the bytes freed
+			virtual int64_t evict_oldest() { return 0; }
+			virtual ~Consumer() {}
+		};
+
+	private:
+		struct Registration {
+			String name;
+			Consumer* consumer;
+		};
+
+		static Mutex *mutex;
+		static Vector<Registration> consumers;
+		static int64_t limit;
+		static uint64_t evictions;
+		static int64_t evicted_bytes;
+	public:
+		static void initialize();
+		static void finalize();
+
+		static void add(const String& p_name, Consumer* p_consumer);
+		static void remove(Consumer* p_consumer);
+
+		// 0 means no limit
+		static void set_limit(int64_t p_bytes);
+		static int64_t get_limit();
+
+		// Stamp for last uses, comparable between consumers
+		static uint64_t tick() { return OS::get_singleton()->get_ticks_usec(); }
+		// Evicts across consumers until the total fits the limit.
+		// Consumers call it after growing, never while holding their own lock
+		static void enforce();
+
+		// Bytes per component with the limit and what was evicted so far
+		static Dictionary get_report();
+
+		static int64_t size_of(const String& p_string) { return sizeof(String) + p_string.length() * sizeof(CharType); }
+		static int64_t size_of(const CharString& p_string) { return sizeof(CharString) + p_string.length(); }
+	};
+
+}
+
+#endif // GD_EXPLORER_MEMORY_BUDGET_H
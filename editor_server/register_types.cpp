@@ -5,6 +5,7 @@
 #include "editor_server_plugin.h"
 #include "editor_server.h"
 #include "services/service.h"
+#include "services/editor_action_service.h"
 using namespace gdexplorer;
 #endif
 
@@ -13,9 +14,13 @@ void register_editor_server_types() {
 	EditorPlugins::add_by_type<EditorServerPlugin>();
 	ClassDB::register_class<EditorServer>();
 	ClassDB::register_class<EditorServerService>();
+	ClassDB::register_class<ServiceCompletion>();
+	EditorActionService::initialize();
 #endif
 }
 
 void unregister_editor_server_types() {
-
+#ifdef EDITOR_SERVICE
+	EditorActionService::finalize();
+#endif
 }
@@ -0,0 +1,136 @@
+#include "request_coalescer.h"
+#include <core/hashfuncs.h>
+#include <string.h>
+
+namespace gdexplorer {
+
+	Mutex *RequestCoalescer::mutex = nullptr;
+	Map<String, RequestCoalescer::Flight*> RequestCoalescer::flights;
+	uint64_t RequestCoalescer::leaders = 0;
+	uint64_t RequestCoalescer::coalesced = 0;
+	uint64_t RequestCoalescer::coalesced_running = 0;
+	uint64_t RequestCoalescer::collisions = 0;
+	int RequestCoalescer::live_flights = 0;
+	bool RequestCoalescer::finalizing = false;
+
+	void RequestCoalescer::initialize() {
+		if (!mutex) {
+			mutex = Mutex::create();
+			finalizing = false;
+		}
+	}
+
+	void RequestCoalescer::finalize() {
+		if (!mutex || finalizing)
+			return;
+		mutex->lock();
+		finalizing = true;
+		bool idle = live_flights == 0;
+		mutex->unlock();
+		// Otherwise the last flight released takes the mutex with it
+		if (idle) {
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	RequestCoalescer::Flight* RequestCoalescer::join(const String &p_action, const uint8_t *p_body, int p_len, bool &r_leader) {
+		ERR_FAIL_COND_V(!mutex, nullptr);
+		String key = p_action + ":" + itos(hash_djb2_buffer(p_body, p_len)) + ":" + itos(p_len);
+		mutex->lock();
+		if (finalizing) {
+			mutex->unlock();
+			return nullptr;
+		}
+		Map<String, Flight*>::Element *E = flights.find(key);
+		if (E) {
+			Flight* flight = E->get();
+			if (memcmp(flight->body.ptr(), p_body, p_len) != 0) {
+				collisions++;
+				mutex->unlock();
+				return nullptr;
+			}
+			flight->references++;
+			coalesced++;
+			if (flight->running)
+				coalesced_running++;
+			mutex->unlock();
+			r_leader = false;
+			return flight;
+		}
+		Flight* flight = memnew(Flight);
+		flight->key = key;
+		flight->body.resize(p_len);
+		memcpy(flight->body.ptr(), p_body, p_len);
+		flight->done = Semaphore::create();
+		flights[key] = flight;
+		live_flights++;
+		leaders++;
+		mutex->unlock();
+		r_leader = true;
+		return flight;
+	}
+
+	void RequestCoalescer::_unlist(Flight *p_flight) {
+		Map<String, Flight*>::Element *E = flights.find(p_flight->key);
+		if (E && E->get() == p_flight)
+			flights.erase(E);
+	}
+
+	void RequestCoalescer::start(Flight *p_flight) {
+		mutex->lock();
+		p_flight->running = true;
+		mutex->unlock();
+	}
+
+	void RequestCoalescer::finish(Flight *p_flight, const CharString &p_response) {
+		mutex->lock();
+		_unlist(p_flight);
+		// No one joins once the flight left the table, so the count of waiters is final
+		p_flight->response = p_response;
+		int waiters = p_flight->references - 1;
+		mutex->unlock();
+		for (int i = 0; i < waiters; i++)
+			p_flight->done->post();
+		_release(p_flight);
+	}
+
+	CharString RequestCoalescer::wait(Flight *p_flight) {
+		p_flight->done->wait();
+		CharString response = p_flight->response;
+		_release(p_flight);
+		return response;
+	}
+
+	void RequestCoalescer::_release(Flight *p_flight) {
+		mutex->lock();
+		bool last = --p_flight->references == 0;
+		bool gone = false;
+		if (last)
+			gone = --live_flights == 0 && finalizing;
+		mutex->unlock();
+		if (last) {
+			memdelete(p_flight->done);
+			memdelete(p_flight);
+		}
+		if (gone) {
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	Dictionary RequestCoalescer::get_stats() {
+		Dictionary stats;
+		ERR_FAIL_COND_V(!mutex, stats);
+		mutex->lock();
+		// Counts go to Variant as reals, an int is too small for long sessions
+		stats["resolved"] = double(leaders);
+		stats["coalesced"] = double(coalesced);
+		stats["coalesced_running"] = double(coalesced_running);
+		stats["collisions"] = double(collisions);
+		stats["in_flight"] = flights.size();
+		mutex->unlock();
+		return stats;
+	}
+
+}
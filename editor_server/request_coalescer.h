@@ -0,0 +1,56 @@
+#ifndef GD_EXPLORER_REQUEST_COALESCER_H
+#define GD_EXPLORER_REQUEST_COALESCER_H
+
+#include <core/ustring.h>
+#include <core/dictionary.h>
+#include <core/os/mutex.h>
+#include <core/os/semaphore.h>
+
+namespace gdexplorer {
+
+	// Lets identical requests that arrive while one of them is queued or resolved share its encoded response
+	class RequestCoalescer {
+	public:
+		struct Flight {
+			String key;
+			Vector<uint8_t> body;
+			CharString response;
+			Semaphore *done;
+			// Connections that will read the response, the leader included
+			int references = 1;
+			// Set once the leader's computation runs, later joins wait on it instead of starting their own
+			bool running = false;
+		};
+
+	private:
+		static Mutex *mutex;
+		static Map<String, Flight*> flights;
+		// Flights not released yet, in the table or not. The mutex outlives finalize() until they are gone
+		static int live_flights;
+		static bool finalizing;
+		static uint64_t leaders;
+		static uint64_t coalesced;
+		// Joins that found the computation already running rather than queued
+		static uint64_t coalesced_running;
+		static uint64_t collisions;
+
+		static void _release(Flight* p_flight);
+		static void _unlist(Flight* p_flight);
+	public:
+		static void initialize();
+		static void finalize();
+
+		// Returns the flight for the action and body. r_leader is set when the caller has to resolve it
+		// and pass the response to finish(), everybody else calls wait(). Null when the key is taken by another body
+		static Flight* join(const String& p_action, const uint8_t* p_body, int p_len, bool& r_leader);
+		// Marks the computation as started, the flight stays open to newcomers until finish()
+		static void start(Flight* p_flight);
+		static void finish(Flight* p_flight, const CharString& p_response);
+		static CharString wait(Flight* p_flight);
+
+		static Dictionary get_stats();
+	};
+
+}
+
+#endif // GD_EXPLORER_REQUEST_COALESCER_H
@@ -0,0 +1,98 @@
+#include "request_scheduler.h"
+
+namespace gdexplorer {
+
+	RequestScheduler::RequestScheduler(int p_workers, int p_max_bulk) {
+		mutex = Mutex::create();
+		pending = Semaphore::create();
+		max_background = MAX(p_workers - 1, 1);
+		max_bulk = CLAMP(p_max_bulk, 1, max_background);
+		for (int i = 0; i < MAX(p_workers, 1); i++)
+			workers.push_back(Thread::create(_worker, this));
+	}
+
+	RequestScheduler::~RequestScheduler() {
+		mutex->lock();
+		quit = true;
+		mutex->unlock();
+		for (int i = 0; i < workers.size(); i++)
+			pending->post();
+		for (int i = 0; i < workers.size(); i++) {
+			Thread::wait_to_finish(workers[i]);
+			memdelete(workers[i]);
+		}
+		// Nobody will run what is left, release the waiting connections
+		for (int p = 0; p < EditorServerService::PRIORITY_MAX; p++) {
+			for (List<Job*>::Element *E = queues[p].front(); E; E = E->next())
+				E->get()->done->post();
+			queues[p].clear();
+		}
+		memdelete(pending);
+		memdelete(mutex);
+	}
+
+	RequestScheduler::Job* RequestScheduler::_take() {
+		for (int p = 0; p < EditorServerService::PRIORITY_MAX; p++) {
+			if (queues[p].empty())
+				continue;
+			if (p != EditorServerService::PRIORITY_INTERACTIVE) {
+				if (running_background >= max_background)
+					return nullptr;
+				if (p == EditorServerService::PRIORITY_BULK) {
+					if (running_bulk >= max_bulk)
+						return nullptr;
+					running_bulk++;
+				}
+				running_background++;
+			}
+			Job* job = queues[p].front()->get();
+			queues[p].pop_front();
+			return job;
+		}
+		return nullptr;
+	}
+
+	void RequestScheduler::_worker(void *p_self) {
+		RequestScheduler* self = (RequestScheduler*)p_self;
+		while (true) {
+			self->pending->wait();
+			self->mutex->lock();
+			if (self->quit) {
+				self->mutex->unlock();
+				break;
+			}
+			Job* job = self->_take();
+			self->mutex->unlock();
+			if (!job)
+				continue;
+
+			job->run();
+
+			if (job->priority != EditorServerService::PRIORITY_INTERACTIVE) {
+				self->mutex->lock();
+				self->running_background--;
+				if (job->priority == EditorServerService::PRIORITY_BULK)
+					self->running_bulk--;
+				bool waiting = !self->queues[EditorServerService::PRIORITY_NORMAL].empty() || !self->queues[EditorServerService::PRIORITY_BULK].empty();
+				self->mutex->unlock();
+				// Work held back by the caps can go now
+				if (waiting)
+					self->pending->post();
+			}
+			job->done->post();
+		}
+	}
+
+	void RequestScheduler::run(Job *p_job, EditorServerService::Priority p_priority) {
+		p_job->priority = CLAMP(p_priority, EditorServerService::PRIORITY_INTERACTIVE, EditorServerService::PRIORITY_BULK);
+		p_job->done = Semaphore::create();
+		mutex->lock();
+		queues[p_job->priority].push_back(p_job);
+		mutex->unlock();
+		pending->post();
+		p_job->done->wait();
+		memdelete(p_job->done);
+		p_job->done = nullptr;
+	}
+
+}
@@ -0,0 +1,51 @@
+#ifndef GD_EXPLORER_REQUEST_SCHEDULER_H
+#define GD_EXPLORER_REQUEST_SCHEDULER_H
+
+#include <core/list.h>
+#include <core/vector.h>
+#include <core/os/mutex.h>
+#include <core/os/semaphore.h>
+#include <core/os/thread.h>
+#include "services/service.h"
+
+namespace gdexplorer {
+
+	// Runs service work on a worker pool, interactive jobs first and bulk jobs on a capped number of workers.
+	// Normal and bulk jobs leave one worker free so an interactive job never waits behind them
+	class RequestScheduler {
+	public:
+		class Job {
+			friend class RequestScheduler;
+			Semaphore *done = nullptr;
+			EditorServerService::Priority priority = EditorServerService::PRIORITY_NORMAL;
+		public:
+			virtual void run() = 0;
+			virtual ~Job() {}
+		};
+
+	private:
+		List<Job*> queues[EditorServerService::PRIORITY_MAX];
+		Vector<Thread*> workers;
+		Mutex *mutex;
+		Semaphore *pending;
+		int max_bulk;
+		int running_bulk = 0;
+		int max_background;
+		int running_background = 0;
+		bool quit = false;
+
+		Job* _take();
+		static void _worker(void *p_self);
+	public:
+		// Queues p_job and blocks the calling thread until a worker ran it
+		void run(Job* p_job, EditorServerService::Priority p_priority);
+		int get_worker_count() const { return workers.size(); }
+		int get_max_bulk() const { return max_bulk; }
+
+		RequestScheduler(int p_workers, int p_max_bulk);
+		~RequestScheduler();
+	};
+
+}
+
+#endif // GD_EXPLORER_REQUEST_SCHEDULER_H
@@ -3,9 +3,12 @@
 #include <core/globals.h>
 #include <core/list.h>
 #include <core/script_language.h>
-#include <io/resource_loader.h>
 #include <tools/editor/editor_node.h>
 #include <initializer_list>
+#include "../trace.h"
+#include "source_cache.h"
+#include "../json_writer.h"
+#include "../json_reader.h"
 
 #ifdef GDSCRIPT_ENABLED
 #include "modules/gdscript/gd_script.h"
@@ -15,7 +18,7 @@ namespace gdexplorer {
 
 	Node* _find_node_for_script(Node* p_base, Node* p_current, const CodeCompleteService::Request& request);
 	String _get_text_for_completion(const CodeCompleteService::Request& p_request, String& r_text);
-	String _filter_completion_candidates(int p_col, const String& p_line, const List<String>& p_options, List<String>& p_keywords,Vector<String> &r_suggestions);
+	String _filter_completion_candidates(int p_col, const String& p_line, const List<String>& p_options, List<String>& p_keywords,Vector<String> &r_suggestions, const ServiceDeadline& p_deadline, bool& r_partial);
 	static bool _is_symbol(CharType c) {
 		return c!='_' && ((c>='!' && c<='/') || (c>=':' && c<='@') || (c>='[' && c<='`') || (c>='{' && c<='~') || c=='\t');
 	}
@@ -26,10 +29,13 @@ namespace gdexplorer {
 	Dictionary CodeCompleteService::resolve(const Dictionary &_data) const {
 		Dictionary data(_data);
 		Request request(data["request"]);
+		request.deadline = ServiceDeadline::from_request(data);
 		Result result = complete_code(request);
 
 		Dictionary r_data;
 		r_data["valid"] = result.valid;
+		if (result.partial)
+			r_data["partial"] = true;
 		r_data["prefix"] = result.prefix;
 		r_data["hint"] = result.hint.replace(String::chr(0xFFFF), "\n");
 		r_data["suggestions"]=result.suggestions;
@@ -59,18 +65,7 @@ namespace gdexplorer {
 	}
 
 	CodeCompleteService::Request::Request(const Dictionary &request):row(1), column(1), script_text(""), script_path("") {
-		String path = request.has("path")? request["path"]:"";
-		path = GlobalConfig::get_singleton()->localize_path(path);
-		if(path == "res://" || !path.begins_with("res://"))
-			path = "";
-		script_path = path;
-
-		script_text = request.has("text")? request["text"]:"";
-		if (!script_path.empty() && script_text.empty()) {
-			Ref<Script> script = ResourceLoader::load(script_path);
-			if (!script.is_null() && script.is_valid() && script->cast_to<Script>())
-				script_text = script->get_source_code();
-		}
+		_init(request.has("path")? request["path"]:"", request.has("text")? request["text"]:"");
 
 		if (request.has("cursor")) {
 			Dictionary cursor = request["cursor"];
@@ -81,21 +76,97 @@ namespace gdexplorer {
 		}
 	}
 
+	CodeCompleteService::Request::Request(const JSONObjectView &p_request):row(1), column(1) {
+		_init(p_request.get_string("path"), p_request.get_string("text"));
+
+		JSONObjectView cursor;
+		if (p_request.get_object("cursor", cursor)) {
+			row = MAX(int(cursor.get_int("row", 1)), 1);
+			column = MAX(int(cursor.get_int("column", 1)), 1);
+		}
+	}
+
+	void CodeCompleteService::Request::_init(const String &p_path, const String &p_text) {
+		String path = GlobalConfig::get_singleton()->localize_path(p_path);
+		if(path == "res://" || !path.begins_with("res://"))
+			path = "";
+		script_path = path;
+
+		script_text = p_text;
+		if (!script_path.empty() && script_text.empty())
+			script_text = SourceCache::get(script_path);
+	}
+
+	void CodeCompleteService::Result::write(JSONWriter &p_writer) const {
+		p_writer.begin_object();
+		p_writer.key("valid");
+		p_writer.value(valid);
+		if (partial) {
+			p_writer.key("partial");
+			p_writer.value(true);
+		}
+		p_writer.key("prefix");
+		p_writer.value(prefix);
+		p_writer.key("hint");
+		p_writer.value(hint.replace(String::chr(0xFFFF), "\n"));
+		p_writer.key("suggestions");
+		p_writer.begin_array();
+		for (int i = 0; i < suggestions.size(); i++)
+			p_writer.value(suggestions[i]);
+		p_writer.end_array();
+		p_writer.end_object();
+	}
+
+	namespace {
+		class CodeCompleteCall : public ServiceCall {
+			const CodeCompleteService* service;
+			CodeCompleteService::Request request;
+		public:
+			virtual void resolve(const JSONObjectView& p_body, JSONWriter& p_writer) override {
+				request.deadline = deadline;
+				CodeCompleteService::Result result = service->complete_code(request);
+				p_writer.begin_object();
+				p_body.write_fields(p_writer, "result");
+				p_writer.key("result");
+				result.write(p_writer);
+				p_writer.end_object();
+			}
+			CodeCompleteCall(const CodeCompleteService* p_service, const JSONObjectView& p_request): service(p_service), request(p_request) {}
+		};
+	}
+
+	ServiceCall* CodeCompleteService::decode(const JSONObjectView &p_body) const {
+		JSONObjectView request;
+		p_body.get_object("request", request);
+		return memnew(CodeCompleteCall(this, request));
+	}
+
 	CodeCompleteService::Result CodeCompleteService::complete_code(const CodeCompleteService::Request &request) const {
 		Result result;
 		if(request.valid()) {
-			Node *node = EditorNode::get_singleton()->get_tree()->get_edited_scene_root();
-			if(node)
-				node = _find_node_for_script(node, node, request);
+			Node *node = nullptr;
+			{
+				EDITOR_SERVER_TRACE("find script node");
+				node = EditorNode::get_singleton()->get_tree()->get_edited_scene_root();
+				if(node)
+					node = _find_node_for_script(node, node, request);
+			}
 			String complete_code = request.script_text;
 			String current_line = _get_text_for_completion(request, complete_code);
-			if(!current_line.empty()) {
+			if(request.deadline.expired()) {
+				result.partial = true;
+			}
+			else if(!current_line.empty()) {
 				List<String> options;
 #ifdef GDSCRIPT_ENABLED
-				GDScriptLanguage::get_singleton()->complete_code(complete_code, request.script_path.get_base_dir(), node, &options, result.hint);
+				{
+					EDITOR_SERVER_TRACE("gdscript complete_code");
+					GDScriptLanguage::get_singleton()->complete_code(complete_code, request.script_path.get_base_dir(), node, &options, result.hint);
+				}
 #endif
+				EDITOR_SERVER_TRACE("filter candidates");
 				if (options.size())
-					result.prefix = _filter_completion_candidates(request.column-1, current_line, options, keywords, result.suggestions);
+					result.prefix = _filter_completion_candidates(request.column-1, current_line, options, keywords, result.suggestions, request.deadline, result.partial);
 			}
 			result.valid = result.prefix.length() > 0;
 		}
@@ -141,7 +212,7 @@ namespace gdexplorer {
 		return substrings[row];
 	}
 
-	String _filter_completion_candidates(int p_col, const String& p_line, const List<String>& p_options, List<String>& p_keywords, Vector<String> &r_suggestions){
+	String _filter_completion_candidates(int p_col, const String& p_line, const List<String>& p_options, List<String>& p_keywords, Vector<String> &r_suggestions, const ServiceDeadline& p_deadline, bool& r_partial){
 		int cofs = CLAMP(p_col, 0, p_line.length());
 		const int column = cofs;
 
@@ -201,6 +272,11 @@ namespace gdexplorer {
 		r_suggestions.clear();
 		Vector<float> sim_cache;
 		for(int i=0;i<p_options.size();i++) {
+			// Checking the clock for every option would cost more than ranking it
+			if ((i & 63) == 63 && p_deadline.expired()) {
+				r_partial = true;
+				break;
+			}
 			if (s == p_options[i]) {
 				// A perfect match, stop completion
 				return s;
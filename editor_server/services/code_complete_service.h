@@ -17,18 +17,27 @@ namespace gdexplorer {
 			int column;
 			String script_text;
 			String script_path;
+			ServiceDeadline deadline;
 			Request(const Dictionary& dict);
+			Request(const JSONObjectView& p_request);
+		private:
+			void _init(const String& p_path, const String& p_text);
 		};
 		struct Result {
 			bool valid = false;
+			// Ran out of time, suggestions are the ones ranked so far
+			bool partial = false;
 			String prefix;
 			String hint;
 			Vector<String> suggestions;
+			void write(JSONWriter& p_writer) const;
 		};
 		Result complete_code(const Request& request) const;
 
 	public:
 		virtual Dictionary resolve(const Dictionary& _data) const override;
+		virtual Priority get_priority() const override { return PRIORITY_INTERACTIVE; }
+		virtual ServiceCall* decode(const JSONObjectView& p_body) const override;
 		CodeCompleteService();
 		virtual ~CodeCompleteService() = default;
 	};
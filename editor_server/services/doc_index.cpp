@@ -0,0 +1,267 @@
+#include "doc_index.h"
+#include <core/os/file_access.h>
+#include <core/globals.h>
+#include <string.h>
+#include "../http_protocol.h"
+
+#ifdef UNIX_ENABLED
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gdexplorer {
+
+	namespace {
+
+		struct StringTable {
+			HTTPBuffer bytes;
+			Map<String, uint32_t> offsets;
+
+			uint32_t add(const String& p_str) {
+				const Map<String, uint32_t>::Element *E = offsets.find(p_str);
+				if (E)
+					return E->get();
+				uint32_t ofs = bytes.size();
+				bytes.append(p_str);
+				bytes.push_back(0);
+				offsets[p_str] = ofs;
+				return ofs;
+			}
+		};
+
+		struct IndexBuilder {
+			StringTable strings;
+			Vector<uint32_t> classes;
+			Vector<uint32_t> members;
+			Vector<uint32_t> arguments;
+
+			void add_method(DocIndex::MemberKind p_kind, const DocData::MethodDoc& m) {
+				members.push_back(p_kind);
+				members.push_back(strings.add(m.name));
+				members.push_back(strings.add(m.return_type));
+				members.push_back(strings.add(m.description));
+				members.push_back(arguments.size() / 3);
+				members.push_back(m.arguments.size());
+				for (int i = 0; i < m.arguments.size(); i++) {
+					arguments.push_back(strings.add(m.arguments[i].name));
+					arguments.push_back(strings.add(m.arguments[i].type));
+					arguments.push_back(strings.add(m.arguments[i].default_value));
+				}
+			}
+
+			void add_property(DocIndex::MemberKind p_kind, const DocData::PropertyDoc& p) {
+				members.push_back(p_kind);
+				members.push_back(strings.add(p.name));
+				members.push_back(strings.add(p.type));
+				members.push_back(strings.add(p.description));
+				members.push_back(0);
+				members.push_back(0);
+			}
+
+			void add_constant(const DocData::ConstantDoc& c) {
+				members.push_back(DocIndex::MEMBER_CONSTANT);
+				members.push_back(strings.add(c.name));
+				members.push_back(strings.add(c.value));
+				members.push_back(strings.add(c.description));
+				members.push_back(0);
+				members.push_back(0);
+			}
+
+			void add_class(const DocData::ClassDoc& c) {
+				classes.push_back(strings.add(c.name));
+				classes.push_back(strings.add(c.inherits));
+				classes.push_back(strings.add(c.category));
+				classes.push_back(strings.add(c.brief_description));
+				classes.push_back(strings.add(c.description));
+				uint32_t first = members.size() / 6;
+				for (int i = 0; i < c.methods.size(); i++)
+					add_method(DocIndex::MEMBER_METHOD, c.methods[i]);
+				for (int i = 0; i < c.signals.size(); i++)
+					add_method(DocIndex::MEMBER_SIGNAL, c.signals[i]);
+				for (int i = 0; i < c.constants.size(); i++)
+					add_constant(c.constants[i]);
+				for (int i = 0; i < c.properties.size(); i++)
+					add_property(DocIndex::MEMBER_PROPERTY, c.properties[i]);
+				for (int i = 0; i < c.theme_properties.size(); i++)
+					add_property(DocIndex::MEMBER_THEME_PROPERTY, c.theme_properties[i]);
+				classes.push_back(first);
+				classes.push_back(members.size() / 6 - first);
+			}
+		};
+
+		void _store_records(FileAccess* p_file, const Vector<uint32_t>& p_records) {
+			for (int i = 0; i < p_records.size(); i++)
+				p_file->store_32(p_records[i]);
+		}
+	}
+
+	Error DocIndex::write(const DocData *p_doc, const String &p_path) {
+		ERR_FAIL_COND_V(!p_doc, ERR_INVALID_PARAMETER);
+
+		IndexBuilder builder;
+		uint32_t doc_version = builder.strings.add(p_doc->version);
+		// Map iteration is ordered by name, which is the order the reader searches in
+		for (const Map<String, DocData::ClassDoc>::Element *E = p_doc->class_list.front(); E; E = E->next())
+			builder.add_class(E->value());
+
+		uint32_t class_count = builder.classes.size() / 7;
+		uint32_t classes_ofs = HEADER_SIZE;
+		uint32_t members_ofs = classes_ofs + builder.classes.size() * 4;
+		uint32_t arguments_ofs = members_ofs + builder.members.size() * 4;
+		uint32_t strings_ofs = arguments_ofs + builder.arguments.size() * 4;
+
+		FileAccess* file = FileAccess::open(p_path, FileAccess::WRITE);
+		if (!file)
+			return ERR_CANT_CREATE;
+		file->store_buffer((const uint8_t*)"GDDI", 4);
+		file->store_32(FORMAT_VERSION);
+		file->store_32(doc_version);
+		file->store_32(class_count);
+		file->store_32(classes_ofs);
+		file->store_32(members_ofs);
+		file->store_32(arguments_ofs);
+		file->store_32(strings_ofs);
+		file->store_32(builder.strings.bytes.size());
+		_store_records(file, builder.classes);
+		_store_records(file, builder.members);
+		_store_records(file, builder.arguments);
+		file->store_buffer(builder.strings.bytes.ptr(), builder.strings.bytes.size());
+		file->close();
+		Error err = file->get_error();
+		memdelete(file);
+		return err;
+	}
+
+	uint32_t DocIndexReader::_u32(uint64_t p_ofs) const {
+		if (p_ofs + 4 > size)
+			return 0;
+		const uint8_t* p = data + p_ofs;
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+
+	Error DocIndexReader::open(const String &p_path) {
+		close();
+		String path = GlobalConfig::get_singleton()->globalize_path(p_path);
+#ifdef UNIX_ENABLED
+		int fd = ::open(path.utf8().get_data(), O_RDONLY);
+		if (fd < 0)
+			return ERR_FILE_CANT_OPEN;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size < DocIndex::HEADER_SIZE || uint64_t(st.st_size) > UINT32_MAX) {
+			::close(fd);
+			return ERR_FILE_CORRUPT;
+		}
+		void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED)
+			return ERR_FILE_CANT_READ;
+		mapping = mapped;
+		data = (const uint8_t*)mapped;
+		size = st.st_size;
+#else
+		buffer = FileAccess::get_file_as_array(path);
+		if (buffer.size() < DocIndex::HEADER_SIZE)
+			return ERR_FILE_CORRUPT;
+		data = buffer.ptr();
+		size = buffer.size();
+#endif
+		if (memcmp(data, "GDDI", 4) != 0 || _u32(4) != DocIndex::FORMAT_VERSION) {
+			close();
+			return ERR_FILE_UNRECOGNIZED;
+		}
+		doc_version = _u32(8);
+		class_count = _u32(12);
+		classes_ofs = _u32(16);
+		members_ofs = _u32(20);
+		arguments_ofs = _u32(24);
+		strings_ofs = _u32(28);
+		strings_size = _u32(32);
+		// Tables follow each other in this order, the string table ends with the NUL of its last string
+		bool valid = uint64_t(classes_ofs) + uint64_t(class_count) * DocIndex::CLASS_RECORD_SIZE <= members_ofs &&
+				members_ofs <= arguments_ofs && arguments_ofs <= strings_ofs &&
+				uint64_t(strings_ofs) + strings_size <= size && strings_size > 0 &&
+				data[strings_ofs + strings_size - 1] == 0;
+		if (!valid) {
+			close();
+			return ERR_FILE_CORRUPT;
+		}
+		member_count = (arguments_ofs - members_ofs) / DocIndex::MEMBER_RECORD_SIZE;
+		argument_count = (strings_ofs - arguments_ofs) / DocIndex::ARGUMENT_RECORD_SIZE;
+		return OK;
+	}
+
+	void DocIndexReader::close() {
+#ifdef UNIX_ENABLED
+		if (mapping) {
+			munmap(mapping, size);
+			mapping = nullptr;
+		}
+#endif
+		buffer.clear();
+		data = nullptr;
+		size = 0;
+		class_count = 0;
+		strings_size = 0;
+		member_count = 0;
+		argument_count = 0;
+	}
+
+	const char* DocIndexReader::get_string(uint32_t p_ofs) const {
+		if (!data || p_ofs >= strings_size)
+			return "";
+		return (const char*)data + strings_ofs + p_ofs;
+	}
+
+	DocIndexReader::Class DocIndexReader::get_class(uint32_t p_idx) const {
+		uint64_t ofs = classes_ofs + uint64_t(p_idx) * DocIndex::CLASS_RECORD_SIZE;
+		Class c;
+		c.name = get_string(_u32(ofs));
+		c.inherits = get_string(_u32(ofs + 4));
+		c.category = get_string(_u32(ofs + 8));
+		c.brief_description = get_string(_u32(ofs + 12));
+		c.description = get_string(_u32(ofs + 16));
+		c.first_member = _u32(ofs + 20);
+		c.member_count = _u32(ofs + 24);
+		return c;
+	}
+
+	DocIndexReader::Member DocIndexReader::get_member(uint32_t p_idx) const {
+		uint64_t ofs = members_ofs + uint64_t(p_idx) * DocIndex::MEMBER_RECORD_SIZE;
+		Member m;
+		m.kind = DocIndex::MemberKind(_u32(ofs));
+		m.name = get_string(_u32(ofs + 4));
+		m.type = get_string(_u32(ofs + 8));
+		m.description = get_string(_u32(ofs + 12));
+		m.first_argument = _u32(ofs + 16);
+		m.argument_count = _u32(ofs + 20);
+		return m;
+	}
+
+	DocIndexReader::Argument DocIndexReader::get_argument(uint32_t p_idx) const {
+		uint64_t ofs = arguments_ofs + uint64_t(p_idx) * DocIndex::ARGUMENT_RECORD_SIZE;
+		Argument a;
+		a.name = get_string(_u32(ofs));
+		a.type = get_string(_u32(ofs + 4));
+		a.default_value = get_string(_u32(ofs + 8));
+		return a;
+	}
+
+	int DocIndexReader::find_class(const char *p_name) const {
+		int low = 0;
+		int high = int(class_count) - 1;
+		while (low <= high) {
+			int mid = (low + high) / 2;
+			int cmp = strcmp(get_string(_u32(classes_ofs + uint64_t(mid) * DocIndex::CLASS_RECORD_SIZE)), p_name);
+			if (cmp == 0)
+				return mid;
+			if (cmp < 0)
+				low = mid + 1;
+			else
+				high = mid - 1;
+		}
+		return -1;
+	}
+
+}
@@ -0,0 +1,110 @@
+#ifndef GD_EXPLORER_DOC_INDEX_H
+#define GD_EXPLORER_DOC_INDEX_H
+
+#include <core/ustring.h>
+#include <core/vector.h>
+#include <tools/doc/doc_data.h>
+
+namespace gdexplorer {
+
+	/*
+	 * Binary doc index, all integers are little endian uint32:
+	 *
+	 *   header     magic "GDDI", format version, doc version string, class count,
+	 *              offsets of the class directory, member records, argument records and string table
+	 *   classes    name, inherits, category, brief description, description, first member, member count;
+	 *              sorted by name so a class is found by binary search
+	 *   members    kind, name, type, description, first argument, argument count
+	 *   arguments  name, type, default value
+	 *   strings    NUL terminated UTF-8, referenced by offset from the start of the table
+	 */
+	class DocIndex {
+	public:
+		enum {
+			FORMAT_VERSION = 1,
+			HEADER_SIZE = 9 * 4,
+			CLASS_RECORD_SIZE = 7 * 4,
+			MEMBER_RECORD_SIZE = 6 * 4,
+			ARGUMENT_RECORD_SIZE = 3 * 4,
+		};
+
+		enum MemberKind {
+			MEMBER_METHOD,
+			MEMBER_SIGNAL,
+			MEMBER_CONSTANT,
+			MEMBER_PROPERTY,
+			MEMBER_THEME_PROPERTY,
+		};
+
+		static Error write(const DocData* p_doc, const String& p_path);
+	};
+
+	// Read only view of a doc index file, mapped into memory where the platform allows it
+	class DocIndexReader {
+		const uint8_t* data = nullptr;
+		uint32_t size = 0;
+		Vector<uint8_t> buffer;
+#ifdef UNIX_ENABLED
+		void* mapping = nullptr;
+#endif
+		uint32_t class_count = 0;
+		uint32_t classes_ofs = 0;
+		uint32_t members_ofs = 0;
+		uint32_t arguments_ofs = 0;
+		uint32_t strings_ofs = 0;
+		uint32_t strings_size = 0;
+		uint32_t member_count = 0;
+		uint32_t argument_count = 0;
+		uint32_t doc_version = 0;
+
+		// Offsets are 64 bit so record arithmetic on damaged headers can not wrap
+		uint32_t _u32(uint64_t p_ofs) const;
+	public:
+		struct Class {
+			const char* name;
+			const char* inherits;
+			const char* category;
+			const char* brief_description;
+			const char* description;
+			uint32_t first_member;
+			uint32_t member_count;
+		};
+
+		struct Member {
+			DocIndex::MemberKind kind;
+			const char* name;
+			const char* type;
+			const char* description;
+			uint32_t first_argument;
+			uint32_t argument_count;
+		};
+
+		struct Argument {
+			const char* name;
+			const char* type;
+			const char* default_value;
+		};
+
+		// Fails on files whose tables do not fit or whose string table is not NUL terminated
+		Error open(const String& p_path);
+		void close();
+		bool is_open() const { return data != nullptr; }
+
+		const char* get_string(uint32_t p_ofs) const;
+		const char* get_doc_version() const { return get_string(doc_version); }
+		uint32_t get_class_count() const { return class_count; }
+		uint32_t get_member_count() const { return member_count; }
+		uint32_t get_argument_count() const { return argument_count; }
+		Class get_class(uint32_t p_idx) const;
+		Member get_member(uint32_t p_idx) const;
+		Argument get_argument(uint32_t p_idx) const;
+		// Index of the class named p_name or -1
+		int find_class(const char* p_name) const;
+
+		DocIndexReader() {}
+		~DocIndexReader() { close(); }
+	};
+
+}
+
+#endif // GD_EXPLORER_DOC_INDEX_H
@@ -0,0 +1,118 @@
+#include "doc_json.h"
+
+namespace gdexplorer {
+
+	void write_argument_doc(JSONWriter& w, const DocData::ArgumentDoc& arg) {
+		w.begin_object();
+		w.key("name");
+		w.value(arg.name);
+		w.key("type");
+		w.value(arg.type);
+		w.key("default_value");
+		w.value(arg.default_value);
+		w.end_object();
+	}
+
+	void write_constant_doc(JSONWriter& w, const DocData::ConstantDoc& c) {
+		w.begin_object();
+		w.key("name");
+		w.value(c.name);
+		w.key("value");
+		w.value(c.value);
+		w.key("description");
+		w.value(c.description);
+		w.end_object();
+	}
+
+	void write_property_doc(JSONWriter& w, const DocData::PropertyDoc& p) {
+		w.begin_object();
+		w.key("name");
+		w.value(p.name);
+		w.key("type");
+		w.value(p.type);
+		w.key("description");
+		w.value(p.description);
+		w.end_object();
+	}
+
+	void write_method_doc(JSONWriter& w, const DocData::MethodDoc& m) {
+		w.begin_object();
+		w.key("name");
+		w.value(m.name);
+		w.key("return_type");
+		w.value(m.return_type);
+		w.key("qualifiers");
+		w.value(m.qualifiers);
+		w.key("description");
+		w.value(m.description);
+		w.key("arguments");
+		w.begin_array();
+		for(int i=0; i< m.arguments.size(); ++i)
+			write_argument_doc(w, m.arguments[i]);
+		w.end_array();
+		w.end_object();
+	}
+
+	void write_class_doc(JSONWriter& w, const DocData::ClassDoc& c) {
+		w.begin_object();
+		w.key("name");
+		w.value(c.name);
+		w.key("inherits");
+		w.value(c.inherits);
+		w.key("category");
+		w.value(c.category);
+		w.key("brief_description");
+		w.value(c.brief_description);
+		w.key("description");
+		w.value(c.description);
+
+		w.key("methods");
+		w.begin_array();
+		for(int i=0; i< c.methods.size(); ++i)
+			write_method_doc(w, c.methods[i]);
+		w.end_array();
+
+		w.key("signals");
+		w.begin_array();
+		for(int i=0; i< c.signals.size(); ++i)
+			write_method_doc(w, c.signals[i]);
+		w.end_array();
+
+		w.key("constants");
+		w.begin_array();
+		for(int i=0; i< c.constants.size(); ++i)
+			write_constant_doc(w, c.constants[i]);
+		w.end_array();
+
+		w.key("properties");
+		w.begin_array();
+		for(int i=0; i< c.properties.size(); ++i)
+			write_property_doc(w, c.properties[i]);
+		w.end_array();
+
+		w.key("theme_properties");
+		w.begin_array();
+		for(int i=0; i< c.theme_properties.size(); ++i)
+			write_property_doc(w, c.theme_properties[i]);
+		w.end_array();
+
+		w.end_object();
+	}
+
+	void write_doc_data(JSONWriter& w, const DocData* p_doc) {
+		w.begin_object();
+		if(p_doc) {
+			w.key("version");
+			w.value(p_doc->version);
+			w.key("classes");
+			w.begin_object();
+			for(const Map<String,DocData::ClassDoc>::Element* E= p_doc->class_list.front();E;E=E->next()) {
+				w.key(E->key());
+				write_class_doc(w, E->value());
+			}
+			w.end_object();
+		}
+		w.end_object();
+	}
+
+}
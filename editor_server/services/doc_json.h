@@ -0,0 +1,19 @@
+#ifndef GD_EXPLORER_DOC_JSON_H
+#define GD_EXPLORER_DOC_JSON_H
+
+#include <tools/doc/doc_data.h>
+#include "../json_writer.h"
+
+namespace gdexplorer {
+
+	// JSON layout of the engine documentation shared by gendoc and the doc service
+	void write_argument_doc(JSONWriter& w, const DocData::ArgumentDoc& p_arg);
+	void write_constant_doc(JSONWriter& w, const DocData::ConstantDoc& p_constant);
+	void write_property_doc(JSONWriter& w, const DocData::PropertyDoc& p_property);
+	void write_method_doc(JSONWriter& w, const DocData::MethodDoc& p_method);
+	void write_class_doc(JSONWriter& w, const DocData::ClassDoc& p_class);
+	void write_doc_data(JSONWriter& w, const DocData* p_doc);
+
+}
+
+#endif // GD_EXPLORER_DOC_JSON_H
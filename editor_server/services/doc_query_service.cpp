@@ -0,0 +1,348 @@
+#include "doc_query_service.h"
+#include <core/io/json.h>
+#include <tools/editor/editor_help.h>
+#include "doc_json.h"
+#include "editor_action_service.h"
+
+namespace gdexplorer {
+
+	DocQueryService::Request::Request(const Dictionary &request) {
+		class_name = request.has("class")? request["class"]:"";
+		member = request.has("member")? request["member"]:"";
+		inherited = request.has("inherited")? bool(request["inherited"]):true;
+	}
+
+	DocQueryService::DocQueryService() {
+		mutex = Mutex::create();
+		MemoryBudget::add("doc_fragments", this);
+	}
+
+	DocQueryService::~DocQueryService() {
+		MemoryBudget::remove(this);
+		memdelete(mutex);
+	}
+
+	void DocQueryService::_erase_fragment(Map<String, Fragment>::Element *p_fragment) const {
+		memory -= MemoryBudget::size_of(p_fragment->key()) + MemoryBudget::size_of(p_fragment->get().json);
+		lru.erase(p_fragment->get().lru);
+		fragments.erase(p_fragment);
+	}
+
+	void DocQueryService::_clear_fragments(const DocData *p_doc) const {
+		fragments.clear();
+		lru.clear();
+		memory = 0;
+		fingerprint = String();
+		fragments_doc = p_doc;
+	}
+
+	const DocData::ClassDoc* DocQueryService::_get_class(const DocData *p_doc, const String &p_name) const {
+		if (p_name.empty())
+			return nullptr;
+		if (!p_doc)
+			return _get_indexed_class(p_name);
+		const Map<String, DocData::ClassDoc>::Element *E = p_doc->class_list.find(p_name);
+		return E ? &E->value() : nullptr;
+	}
+
+	static DocData::ClassDoc _decode_class(const DocIndexReader& p_index, int p_idx) {
+		DocIndexReader::Class c = p_index.get_class(p_idx);
+		DocData::ClassDoc cls;
+		cls.name = String::utf8(c.name);
+		cls.inherits = String::utf8(c.inherits);
+		cls.category = String::utf8(c.category);
+		cls.brief_description = String::utf8(c.brief_description);
+		cls.description = String::utf8(c.description);
+		uint32_t end = c.first_member + c.member_count;
+		if (end < c.first_member || end > p_index.get_member_count())
+			return cls;
+		for (uint32_t i = c.first_member; i < end; i++) {
+			DocIndexReader::Member m = p_index.get_member(i);
+			if (m.kind == DocIndex::MEMBER_METHOD || m.kind == DocIndex::MEMBER_SIGNAL) {
+				// Qualifiers are not part of the index
+				DocData::MethodDoc method;
+				method.name = String::utf8(m.name);
+				method.return_type = String::utf8(m.type);
+				method.description = String::utf8(m.description);
+				uint32_t args_end = m.first_argument + m.argument_count;
+				for (uint32_t j = m.first_argument; args_end >= m.first_argument && args_end <= p_index.get_argument_count() && j < args_end; j++) {
+					DocIndexReader::Argument a = p_index.get_argument(j);
+					DocData::ArgumentDoc arg;
+					arg.name = String::utf8(a.name);
+					arg.type = String::utf8(a.type);
+					arg.default_value = String::utf8(a.default_value);
+					method.arguments.push_back(arg);
+				}
+				if (m.kind == DocIndex::MEMBER_METHOD)
+					cls.methods.push_back(method);
+				else
+					cls.signals.push_back(method);
+			} else if (m.kind == DocIndex::MEMBER_CONSTANT) {
+				DocData::ConstantDoc constant;
+				constant.name = String::utf8(m.name);
+				constant.value = String::utf8(m.type);
+				constant.description = String::utf8(m.description);
+				cls.constants.push_back(constant);
+			} else {
+				DocData::PropertyDoc property;
+				property.name = String::utf8(m.name);
+				property.type = String::utf8(m.type);
+				property.description = String::utf8(m.description);
+				if (m.kind == DocIndex::MEMBER_PROPERTY)
+					cls.properties.push_back(property);
+				else
+					cls.theme_properties.push_back(property);
+			}
+		}
+		return cls;
+	}
+
+	const DocData::ClassDoc* DocQueryService::_get_indexed_class(const String &p_name) const {
+		mutex->lock();
+		if (!index_opened) {
+			index_opened = true;
+			// Written by the editor plugin's gendoc next to classes.json
+			index.open("res://.vscode/classes.docidx");
+		}
+		const DocData::ClassDoc* cls = nullptr;
+		Map<String, DocData::ClassDoc>::Element *E = indexed_classes.find(p_name);
+		if (E) {
+			cls = &E->get();
+		} else if (index.is_open()) {
+			int idx = index.find_class(p_name.utf8().get_data());
+			if (idx >= 0)
+				cls = &(indexed_classes[p_name] = _decode_class(index, idx));
+		}
+		mutex->unlock();
+		return cls;
+	}
+
+	String DocQueryService::get_etag(const Dictionary &data) const {
+		if (get_script_instance())
+			return String();
+		const DocData* doc = EditorHelp::get_doc_data();
+		if (!doc)
+			return String();
+		mutex->lock();
+		if (fragments_doc != doc)
+			_clear_fragments(doc);
+		if (fingerprint.empty())
+			fingerprint = EditorActionService::get_doc_fingerprint(doc);
+		String version = fingerprint;
+		mutex->unlock();
+		return version;
+	}
+
+	CharString DocQueryService::get_class_fragment(const String &p_class) const {
+		const DocData* doc = EditorHelp::get_doc_data();
+		const DocData::ClassDoc* cls = _get_class(doc, p_class);
+		if (!cls)
+			return CharString();
+
+		mutex->lock();
+		// Doc data was regenerated, drop every memoized class
+		if (fragments_doc != doc)
+			_clear_fragments(doc);
+		Map<String, Fragment>::Element *E = fragments.find(p_class);
+		if (E) {
+			E->get().last_used = MemoryBudget::tick();
+			lru.move_to_back(E->get().lru);
+			CharString json = E->get().json;
+			mutex->unlock();
+			return json;
+		}
+		mutex->unlock();
+
+		JSONBufferSink sink;
+		{
+			JSONWriter writer(&sink);
+			write_class_doc(writer, *cls);
+		}
+		CharString json = sink.get_data();
+
+		Fragment fragment;
+		fragment.json = json;
+		fragment.last_used = MemoryBudget::tick();
+		mutex->lock();
+		E = fragments.find(p_class);
+		if (E)
+			_erase_fragment(E);
+		fragment.lru = lru.push_back(p_class);
+		memory += MemoryBudget::size_of(p_class) + MemoryBudget::size_of(json);
+		fragments[p_class] = fragment;
+		mutex->unlock();
+		MemoryBudget::enforce();
+		return json;
+	}
+
+	int64_t DocQueryService::get_memory_usage() const {
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	uint64_t DocQueryService::get_oldest_use() const {
+		mutex->lock();
+		uint64_t oldest = lru.front() ? fragments[lru.front()->get()].last_used : 0;
+		mutex->unlock();
+		return oldest;
+	}
+
+	int64_t DocQueryService::evict_oldest() {
+		int64_t freed = 0;
+		mutex->lock();
+		Map<String, Fragment>::Element *E = lru.front() ? fragments.find(lru.front()->get()) : nullptr;
+		if (E) {
+			freed = MemoryBudget::size_of(E->key()) + MemoryBudget::size_of(E->get().json);
+			_erase_fragment(E);
+		}
+		mutex->unlock();
+		return freed;
+	}
+
+	Vector<String> DocQueryService::get_inheritance_chain(const String &p_class) const {
+		Vector<String> chain;
+		const DocData* doc = EditorHelp::get_doc_data();
+		const DocData::ClassDoc* cls = _get_class(doc, p_class);
+		while (cls) {
+			// Guard against malformed docs with cyclic inheritance
+			if (chain.find(cls->name) != -1)
+				break;
+			chain.push_back(cls->name);
+			cls = _get_class(doc, cls->inherits);
+		}
+		return chain;
+	}
+
+	bool DocQueryService::_find_member(const DocData *p_doc, const Request &p_request, Member &r_member) const {
+		Vector<String> chain;
+		if (p_request.inherited)
+			chain = get_inheritance_chain(p_request.class_name);
+		else
+			chain.push_back(p_request.class_name);
+
+		for (int c = 0; c < chain.size(); c++) {
+			const DocData::ClassDoc* cls = _get_class(p_doc, chain[c]);
+			if (!cls)
+				continue;
+
+			JSONBufferSink sink;
+			bool found = false;
+			{
+				JSONWriter writer(&sink);
+				for (int i = 0; !found && i < cls->methods.size(); i++) {
+					if (cls->methods[i].name == p_request.member) {
+						write_method_doc(writer, cls->methods[i]);
+						r_member.kind = "method";
+						found = true;
+					}
+				}
+				for (int i = 0; !found && i < cls->properties.size(); i++) {
+					if (cls->properties[i].name == p_request.member) {
+						write_property_doc(writer, cls->properties[i]);
+						r_member.kind = "property";
+						found = true;
+					}
+				}
+				for (int i = 0; !found && i < cls->signals.size(); i++) {
+					if (cls->signals[i].name == p_request.member) {
+						write_method_doc(writer, cls->signals[i]);
+						r_member.kind = "signal";
+						found = true;
+					}
+				}
+				for (int i = 0; !found && i < cls->constants.size(); i++) {
+					if (cls->constants[i].name == p_request.member) {
+						write_constant_doc(writer, cls->constants[i]);
+						r_member.kind = "constant";
+						found = true;
+					}
+				}
+				for (int i = 0; !found && i < cls->theme_properties.size(); i++) {
+					if (cls->theme_properties[i].name == p_request.member) {
+						write_property_doc(writer, cls->theme_properties[i]);
+						r_member.kind = "theme_property";
+						found = true;
+					}
+				}
+			}
+			if (found) {
+				r_member.owner = cls->name;
+				r_member.json = sink.get_data();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void DocQueryService::_write_result(JSONWriter &p_writer, const Request &p_request) const {
+		const DocData* doc = EditorHelp::get_doc_data();
+		p_writer.begin_object();
+
+		bool found = _get_class(doc, p_request.class_name) != nullptr;
+		if (found) {
+			p_writer.key("inherits");
+			p_writer.begin_array();
+			Vector<String> chain = get_inheritance_chain(p_request.class_name);
+			for (int i = 1; i < chain.size(); i++)
+				p_writer.value(chain[i]);
+			p_writer.end_array();
+
+			if (p_request.member.empty()) {
+				p_writer.key("class");
+				p_writer.raw(get_class_fragment(p_request.class_name));
+			} else {
+				Member member;
+				found = _find_member(doc, p_request, member);
+				if (found) {
+					p_writer.key("member");
+					p_writer.begin_object();
+					p_writer.key("class");
+					p_writer.value(member.owner);
+					p_writer.key("kind");
+					p_writer.value(member.kind);
+					p_writer.key("doc");
+					p_writer.raw(member.json);
+					p_writer.end_object();
+				}
+			}
+		}
+
+		p_writer.key("found");
+		p_writer.value(found);
+		p_writer.end_object();
+	}
+
+	bool DocQueryService::resolve_stream(const Dictionary &_data, JSONWriter &p_writer) const {
+		if (get_script_instance())
+			return false;
+		Request request(_data["request"]);
+		p_writer.begin_object();
+		write_fields(p_writer, _data, "result");
+		p_writer.key("result");
+		_write_result(p_writer, request);
+		p_writer.end_object();
+		return true;
+	}
+
+	Dictionary DocQueryService::resolve(const Dictionary &_data) const {
+		Dictionary data(_data);
+		Request request(data["request"]);
+
+		JSONBufferSink sink;
+		{
+			JSONWriter writer(&sink);
+			_write_result(writer, request);
+		}
+		Variant result;
+		String errmsg;
+		int errline = -1;
+		String json;
+		json.parse_utf8((const char*)sink.ptr(), sink.size());
+		if (JSON::parse(json, result, errmsg, errline) == OK)
+			data["result"] = result;
+		return super::resolve(data);
+	}
+
+}
@@ -0,0 +1,78 @@
+#ifndef GD_EXPLORER_DOC_QUERY_SERVICE_H
+#define GD_EXPLORER_DOC_QUERY_SERVICE_H
+
+#include "service.h"
+#include <core/os/mutex.h>
+#include <tools/doc/doc_data.h>
+#include "../memory_budget.h"
+#include "doc_index.h"
+
+namespace gdexplorer {
+
+	// Answers documentation queries for a single class or member instead of dumping all of DocData.
+	// Until the editor has its doc data, classes come from the index the last gendoc left in the project
+	class DocQueryService : public EditorServerService, public MemoryBudget::Consumer {
+		GDCLASS(DocQueryService, EditorServerService);
+		using super = EditorServerService;
+	public:
+		struct Request {
+			String class_name;
+			String member;
+			bool inherited = true;
+			Request(const Dictionary& dict);
+		};
+
+		struct Member {
+			String owner;
+			String kind;
+			CharString json;
+		};
+
+	protected:
+		struct Fragment {
+			CharString json;
+			uint64_t last_used = 0;
+			List<String>::Element* lru = nullptr;
+		};
+
+		mutable Map<String, Fragment> fragments;
+		// Classes from least to most recently used
+		mutable List<String> lru;
+		mutable int64_t memory = 0;
+		mutable const DocData* fragments_doc = nullptr;
+		mutable String fingerprint;
+		mutable DocIndexReader index;
+		mutable bool index_opened = false;
+		// Classes read from the index, kept for good since callers hold pointers to them
+		mutable Map<String, DocData::ClassDoc> indexed_classes;
+		Mutex *mutex;
+
+		const DocData::ClassDoc* _get_class(const DocData* p_doc, const String& p_name) const;
+		const DocData::ClassDoc* _get_indexed_class(const String& p_name) const;
+		bool _find_member(const DocData* p_doc, const Request& p_request, Member& r_member) const;
+		void _write_result(JSONWriter& p_writer, const Request& p_request) const;
+		void _clear_fragments(const DocData* p_doc) const;
+		void _erase_fragment(Map<String, Fragment>::Element* p_fragment) const;
+	public:
+		// Serialized JSON of a class, computed once per class and kept
+		CharString get_class_fragment(const String& p_class) const;
+		Vector<String> get_inheritance_chain(const String& p_class) const;
+
+		virtual Dictionary resolve(const Dictionary& _data) const override;
+		virtual bool resolve_stream(const Dictionary& _data, JSONWriter& p_writer) const override;
+		// Hover and signature help wait on it
+		virtual Priority get_priority() const override { return PRIORITY_INTERACTIVE; }
+		virtual bool can_coalesce(const Dictionary& data) const override { return true; }
+		virtual String get_etag(const Dictionary& data) const override;
+
+		// Fragments are rebuilt from the doc data when asked for again
+		virtual int64_t get_memory_usage() const override;
+		virtual uint64_t get_oldest_use() const override;
+		virtual int64_t evict_oldest() override;
+		DocQueryService();
+		virtual ~DocQueryService();
+	};
+
+}
+
+#endif // GD_EXPLORER_DOC_QUERY_SERVICE_H
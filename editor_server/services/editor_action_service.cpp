@@ -3,12 +3,76 @@
 #include <core/globals.h>
 #include <core/os/os.h>
 #include <core/io/json.h>
-#include <tools/doc/doc_data.h>
 #include <tools/editor/editor_help.h>
+#include "doc_json.h"
+#include "doc_index.h"
+#include <core/os/dir_access.h>
+#include <core/hashfuncs.h>
+#include "../trace.h"
+#include "../traffic_capture.h"
+#include "../request_coalescer.h"
+#include "../http_compression.h"
+#include "../json_reader.h"
+#include "../memory_budget.h"
+#include "script_dependencies.h"
+#include <tools/editor/editor_settings.h>
 
 namespace gdexplorer {
 
-	Dictionary _resolveDocData(const DocData* p_doc);
+	EditorServerService::Priority EditorActionService::get_request_priority(const Dictionary &data, Priority p_registered) const {
+		String command = data.has("command")? data["command"] : "";
+		if(command == "gendoc")
+			return PRIORITY_BULK;
+		return p_registered;
+	}
+
+	bool EditorActionService::runs_on_connection(const Dictionary &data) const {
+		// Replayed requests come back to this server and need the workers themselves
+		String command = data.has("command")? data["command"] : "";
+		return command == "replay";
+	}
+
+	bool EditorActionService::can_coalesce(const Dictionary &data) const {
+		String command = data.has("command")? data["command"] : "";
+		return command == "gendoc";
+	}
+
+	namespace {
+		// Answers with the request and one path field added
+		class EditorPathCall : public ServiceCall {
+			String path;
+		public:
+			virtual void resolve(const JSONObjectView& p_body, JSONWriter& p_writer) override {
+				p_writer.begin_object();
+				p_body.write_fields(p_writer, "path");
+				p_writer.key("path");
+				p_writer.value(path);
+				p_writer.end_object();
+			}
+			EditorPathCall(const String& p_path): path(p_path) {}
+		};
+
+		class EditorVersionCall : public ServiceCall {
+		public:
+			virtual void resolve(const JSONObjectView& p_body, JSONWriter& p_writer) override {
+				p_writer.begin_object();
+				p_writer.key("version");
+				p_writer.value(__DATE__ " " __TIME__);
+				p_writer.end_object();
+			}
+		};
+	}
+
+	ServiceCall* EditorActionService::decode(const JSONObjectView &p_body) const {
+		String command = p_body.get_string("command");
+		if(command == "projectdir")
+			return memnew(EditorPathCall(GlobalConfig::get_singleton()->globalize_path("res://")));
+		if(command == "editorpath")
+			return memnew(EditorPathCall(OS::get_singleton()->get_executable_path()));
+		if(command == "version")
+			return memnew(EditorVersionCall);
+		return nullptr;
+	}
 
 	Dictionary EditorActionService::resolve(const Dictionary &_data) const {
 		Dictionary data = _data;
@@ -30,109 +94,173 @@ namespace gdexplorer {
 				data["version"] = __DATE__ " " __TIME__;
 				return data;
 			}
-			else if(command == "gendoc") {
-				String path = data.has("path")?data["path"]:"";
-				bool done = false;
+			else if(command == "trace") {
+				if(data.has("enable"))
+					EditorServerTrace::set_enabled(data["enable"]);
+				if(data.has("clear") && bool(data["clear"]))
+					EditorServerTrace::clear();
+				String path = data.has("path")? data["path"] : "";
 				if(!path.empty()) {
-					const DocData* doc = EditorHelp::get_doc_data();
-					Dictionary docdata = _resolveDocData(doc);
-					FileAccess* file = FileAccess::open(path, FileAccess::WRITE);
-					if(file && file->get_error() == OK) {
-						file->store_string(JSON::print(docdata));
-						file->close();
-						done = file->get_error() == OK;
-						memdelete(file);
-					}
+					// Load the file in chrome://tracing or ui.perfetto.dev
+					int events = 0;
+					data["done"] = EditorServerTrace::dump(path, &events) == OK;
+					data["events"] = events;
 				}
-				data["done"] = done;
+				data["enabled"] = EditorServerTrace::is_enabled();
+			}
+			else if(command == "capture") {
+				String path = data.has("path")? data["path"] : "";
+				if(!path.empty())
+					data["done"] = TrafficCapture::start(path) == OK;
+				else
+					data["records"] = TrafficCapture::stop();
+				data["capturing"] = TrafficCapture::is_capturing();
+			}
+			else if(command == "dependents") {
+				// Scripts to analyze again after path changed, only those parsed this session are known
+				String path = data.has("path")? data["path"] : "";
+				path = GlobalConfig::get_singleton()->localize_path(path);
+				bool transitive = data.has("transitive")? bool(data["transitive"]) : true;
+				Vector<String> dependents;
+				Vector<String> dependencies;
+				ScriptDependencies::get_dependents(path, transitive, dependents);
+				ScriptDependencies::get_dependencies(path, dependencies);
+				data["dependents"] = dependents;
+				data["dependencies"] = dependencies;
+			}
+			else if(command == "stats") {
+				data["coalescing"] = RequestCoalescer::get_stats();
+				// Compare compress_usec with what the saved bytes cost on the wire to see whether compression pays off
+				data["compression"] = HTTPCompression::get_stats();
+			}
+			else if(command == "memory") {
+				// Estimated bytes per component, entries are evicted across components once the total passes the limit
+				data["memory"] = MemoryBudget::get_report();
+			}
+			else if(command == "replay") {
+				String path = data.has("path")? data["path"] : "";
+				TrafficReplay::Options options;
+				if(data.has("host"))
+					options.host = data["host"];
+				options.port = data.has("port")? int(data["port"]) : int(EditorSettings::get_singleton()->get("network/editor_server_port"));
+				if(data.has("speed"))
+					options.speed = data["speed"];
+				if(data.has("concurrency"))
+					options.concurrency = data["concurrency"];
+				data["result"] = TrafficReplay::replay(path, options);
+			}
+			else if(command == "gendoc") {
+				String path = data.has("path")?data["path"]:"";
+				String index_path = data.has("index_path")? data["index_path"] : "";
+				bool if_changed = data.has("if_changed")? bool(data["if_changed"]) : false;
+				GenDocResult result = gendoc(path, index_path, if_changed);
+				data["done"] = result.done;
+				data["skipped"] = result.skipped;
+				if(!result.index_path.empty())
+					data["index_path"] = result.index_path;
 			}
 		}
 		return super::resolve(data);
 	}
 
-	Dictionary _resolveDocData(const DocData* p_doc) {
-		Dictionary result;
-		if(p_doc) {
-			result["version"] = p_doc->version;
-
-			auto parseArg = [](const DocData::ArgumentDoc& arg) -> Dictionary {
-				Dictionary argd;
-				argd["name"] = arg.name;
-				argd["type"] = arg.type;
-				argd["default_value"] = arg.default_value;
-				return argd;
-			};
-
-			auto parseConstant = [](const DocData::ConstantDoc& c) -> Dictionary {
-				Dictionary cd;
-				cd["name"] = c.name;
-				cd["value"] = c.value;
-				cd["description"] = c.description;
-				return cd;
-			};
-
-			auto parseProperty = [](const DocData::PropertyDoc& p) -> Dictionary {
-				Dictionary pd;
-				pd["name"] = p.name;
-				pd["type"] = p.type;
-				pd["description"] = p.description;
-				return pd;
-			};
-
-			auto parseMethod = [&parseArg](const DocData::MethodDoc& m) -> Dictionary {
-				Dictionary md;
-				md["name"] = m.name;
-				md["return_type"] = m.return_type;
-				md["qualifiers"] = m.qualifiers;
-				md["description"] = m.description;
-				Vector<Variant> arguments;
-				for(int i=0; i< m.arguments.size(); ++i)
-					arguments.push_back(parseArg(m.arguments[i]));
-				md["arguments"] = arguments;
-				return md;
-			};
-
-			auto parseClass = [&parseMethod, &parseConstant, &parseProperty](const DocData::ClassDoc& c) -> Dictionary {
-				Dictionary cd;
-				cd["name"] = c.name;
-				cd["inherits"] = c.inherits;
-				cd["category"] = c.category;
-				cd["brief_description"] = c.brief_description;
-				cd["description"] = c.description;
-
-				Vector<Variant> methods;
-				for(int i=0; i< c.methods.size(); ++i)
-					methods.push_back(parseMethod(c.methods[i]));
-				cd["methods"] = methods;
-
-				Vector<Variant> signals;
-				for(int i=0; i< c.signals.size(); ++i)
-					signals.push_back(parseMethod(c.signals[i]));
-				cd["signals"] = signals;
-
-				Vector<Variant> constants;
-				for(int i=0; i< c.constants.size(); ++i)
-					constants.push_back(parseConstant(c.constants[i]));
-				cd["constants"] = constants;
-
-				Vector<Variant> properties;
-				for(int i=0; i< c.properties.size(); ++i)
-					properties.push_back(parseProperty(c.properties[i]));
-				cd["properties"] = properties;
-
-				Vector<Variant> theme_properties;
-				for(int i=0; i< c.theme_properties.size(); ++i)
-					theme_properties.push_back(parseProperty(c.theme_properties[i]));
-				cd["theme_properties"] = theme_properties;
-
-				return cd;
-			};
-
-			Dictionary classes = Dictionary();
-			for(Map<String,DocData::ClassDoc>::Element* E= p_doc->class_list.front();E;E=E->next())
-				classes[E->key()] = parseClass(E->value());
-			result["classes"] = classes;
+	String EditorActionService::get_doc_fingerprint(const DocData *p_doc) {
+		if(!p_doc)
+			return String();
+		uint32_t hash = p_doc->version.hash();
+		for(const Map<String,DocData::ClassDoc>::Element* E= p_doc->class_list.front();E;E=E->next()) {
+			const DocData::ClassDoc& c = E->value();
+			hash = hash_djb2_one_32(c.name.hash(), hash);
+			hash = hash_djb2_one_32(c.methods.size(), hash);
+			hash = hash_djb2_one_32(c.signals.size(), hash);
+			hash = hash_djb2_one_32(c.constants.size(), hash);
+			hash = hash_djb2_one_32(c.properties.size(), hash);
+			hash = hash_djb2_one_32(c.theme_properties.size(), hash);
+			hash = hash_djb2_one_32(c.description.length(), hash);
+		}
+		return p_doc->version + "-" + itos(p_doc->class_list.size()) + "-" + String::num_int64(hash, 16);
+	}
+
+	static Mutex *gendoc_mutex = nullptr;
+
+	void EditorActionService::initialize() {
+		if(!gendoc_mutex)
+			gendoc_mutex = Mutex::create();
+	}
+
+	void EditorActionService::finalize() {
+		if(gendoc_mutex) {
+			memdelete(gendoc_mutex);
+			gendoc_mutex = nullptr;
+		}
+	}
+
+	static EditorActionService::GenDocResult _gendoc(const String &p_path, const String &p_index_path, bool p_if_changed) {
+		EditorActionService::GenDocResult result;
+
+		const DocData* doc = EditorHelp::get_doc_data();
+		String index_path = p_index_path;
+		if(index_path.empty()) {
+			int dot = p_path.find_last(".");
+			index_path = (dot > p_path.find_last("/")? p_path.substr(0, dot) : p_path) + ".docidx";
 		}
+
+		String fingerprint = EditorActionService::get_doc_fingerprint(doc);
+		String fingerprint_path = p_path + ".fingerprint";
+		if(p_if_changed && !fingerprint.empty() && FileAccess::exists(p_path) && FileAccess::exists(index_path)) {
+			FileAccess* file = FileAccess::open(fingerprint_path, FileAccess::READ);
+			if(file) {
+				String stored = file->get_line().strip_edges();
+				memdelete(file);
+				if(stored == fingerprint) {
+					result.done = true;
+					result.skipped = true;
+					result.index_path = index_path;
+					return result;
+				}
+			}
+		}
+
+		String tmp_path = p_path + ".tmp";
+		FileAccess* file = FileAccess::open(tmp_path, FileAccess::WRITE);
+		if(file && file->get_error() == OK) {
+			// Stream the classes to the file instead of building the whole tree in memory
+			JSONFileSink sink(file);
+			JSONWriter writer(&sink);
+			write_doc_data(writer, doc);
+			result.done = writer.flush() == OK;
+			file->close();
+			result.done = result.done && file->get_error() == OK;
+			memdelete(file);
+		}
+		else if(file) {
+			memdelete(file);
+		}
+		result.done = result.done && EditorServerService::replace_file(tmp_path, p_path) == OK;
+
+		if(result.done && doc) {
+			// Binary index next to the JSON for tools that look classes up without parsing
+			String tmp_index = index_path + ".tmp";
+			if(DocIndex::write(doc, tmp_index) == OK && EditorServerService::replace_file(tmp_index, index_path) == OK)
+				result.index_path = index_path;
+
+			FileAccess* fp = FileAccess::open(fingerprint_path, FileAccess::WRITE);
+			if(fp) {
+				fp->store_line(fingerprint);
+				fp->close();
+				memdelete(fp);
+			}
+		}
+		return result;
+	}
+
+	EditorActionService::GenDocResult EditorActionService::gendoc(const String &p_path, const String &p_index_path, bool p_if_changed) {
+		GenDocResult result;
+		if(p_path.empty())
+			return result;
+		ERR_FAIL_COND_V(!gendoc_mutex, result);
+		gendoc_mutex->lock();
+		result = _gendoc(p_path, p_index_path, p_if_changed);
+		gendoc_mutex->unlock();
 		return result;
 	}
 
@@ -2,6 +2,7 @@
 #define EDITOR_ACTION_SERVICE_H
 
 #include "service.h"
+#include <tools/doc/doc_data.h>
 
 namespace gdexplorer {
 	class EditorActionService : public EditorServerService
@@ -9,7 +10,26 @@ namespace gdexplorer {
 		GDCLASS(EditorActionService, EditorServerService);
 		using super = EditorServerService;
 	public:
+		struct GenDocResult {
+			bool done = false;
+			// Nothing changed since the files on disk were written
+			bool skipped = false;
+			String index_path;
+		};
+		static void initialize();
+		static void finalize();
+		// Writes the doc data as JSON to p_path and as a binary index next to it, both replaced atomically.
+		// Runs one at a time, the editor plugin and remote commands share the temporary files
+		static GenDocResult gendoc(const String& p_path, const String& p_index_path = String(), bool p_if_changed = false);
+		static String get_doc_fingerprint(const DocData* p_doc);
+
 		virtual Dictionary resolve(const Dictionary& data) const override;
+		// Doc generation and traffic replay run as bulk work
+		virtual Priority get_request_priority(const Dictionary& data, Priority p_registered) const override;
+		virtual bool runs_on_connection(const Dictionary& data) const override;
+		virtual bool can_coalesce(const Dictionary& data) const override;
+		// Only the path and version queries, the other commands keep the Dictionary path
+		virtual ServiceCall* decode(const JSONObjectView& p_body) const override;
 		EditorActionService() = default;
 		virtual ~EditorActionService() = default;
 	};
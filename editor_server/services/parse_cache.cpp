@@ -0,0 +1,433 @@
+#include "parse_cache.h"
+#include <core/os/file_access.h>
+#include <core/os/dir_access.h>
+#include <core/set.h>
+#include <version.h>
+
+namespace gdexplorer {
+
+	// Results depend on the engine and GDScript build that produced them
+	static const char* _build_stamp = VERSION_FULL_NAME;
+
+	static void _store_members(FileAccess* f, const Vector<ScriptParseService::Member>& p_members) {
+		f->store_32(p_members.size());
+		for (int i = 0; i < p_members.size(); i++) {
+			f->store_pascal_string(p_members[i].name);
+			f->store_32(p_members[i].line);
+		}
+	}
+
+	// Whether p_count items of at least p_size bytes each can still be in the file
+	static bool _fits(FileAccess* f, uint64_t p_count, uint64_t p_size) {
+		return p_count <= (f->get_len() - f->get_pos()) / p_size;
+	}
+
+	// get_pascal_string() would allocate whatever length a damaged file claims
+	static bool _load_string(FileAccess* f, String& r_string) {
+		uint32_t length = f->get_32();
+		if (!_fits(f, length, 1))
+			return false;
+		CharString utf8;
+		utf8.resize(length + 1);
+		f->get_buffer((uint8_t*)utf8.ptr(), length);
+		utf8[length] = 0;
+		r_string.parse_utf8(utf8.ptr());
+		return true;
+	}
+
+	static bool _load_members(FileAccess* f, Vector<ScriptParseService::Member>& r_members) {
+		uint32_t count = f->get_32();
+		// Name length and line
+		if (!_fits(f, count, 8))
+			return false;
+		for (uint32_t i = 0; i < count; i++) {
+			ScriptParseService::Member m;
+			if (!_load_string(f, m.name))
+				return false;
+			m.line = int(f->get_32());
+			r_members.push_back(m);
+		}
+		return true;
+	}
+
+	ScriptParseCache::ScriptParseCache(const String &p_cache_path): cache_path(p_cache_path) {
+		mutex = Mutex::create();
+		save_mutex = Mutex::create();
+		MemoryBudget::add("parse_cache", this);
+	}
+
+	ScriptParseCache::~ScriptParseCache() {
+		MemoryBudget::remove(this);
+		quit = true;
+		if (revalidate_thread) {
+			Thread::wait_to_finish(revalidate_thread);
+			memdelete(revalidate_thread);
+		}
+		if (save_thread) {
+			Thread::wait_to_finish(save_thread);
+			memdelete(save_thread);
+		}
+		memdelete(save_mutex);
+		memdelete(mutex);
+	}
+
+	static int64_t _size_of_members(const Vector<ScriptParseService::Member>& p_members) {
+		int64_t bytes = 0;
+		for (int i = 0; i < p_members.size(); i++)
+			bytes += sizeof(ScriptParseService::Member) + MemoryBudget::size_of(p_members[i].name);
+		return bytes;
+	}
+
+	int64_t ScriptParseCache::_size_of(const String &p_path, const Entry &p_entry) {
+		const ScriptParseService::Result& r = p_entry.result;
+		int64_t bytes = sizeof(Entry) + MemoryBudget::size_of(p_path) + MemoryBudget::size_of(r.base_class) + MemoryBudget::size_of(r.native_calss);
+		for (int i = 0; i < r.errors.size(); i++)
+			bytes += sizeof(ScriptParseService::Error) + MemoryBudget::size_of(r.errors[i].message);
+		bytes += _size_of_members(r.functions) + _size_of_members(r.members) + _size_of_members(r.signals) + _size_of_members(r.constants);
+		for (int i = 0; i < r.dependencies.size(); i++)
+			bytes += MemoryBudget::size_of(r.dependencies[i]);
+		return bytes;
+	}
+
+	void ScriptParseCache::_insert(const String &p_path, Entry &p_entry) {
+		Map<String, Entry>::Element *E = entries.find(p_path);
+		if (E)
+			_erase(E);
+		p_entry.lru = lru.push_back(p_path);
+		memory += _size_of(p_path, p_entry);
+		entries[p_path] = p_entry;
+		evicted.erase(p_path);
+	}
+
+	void ScriptParseCache::_erase(Map<String, Entry>::Element *p_entry) {
+		memory -= _size_of(p_entry->key(), p_entry->get());
+		lru.erase(p_entry->get().lru);
+		entries.erase(p_entry);
+	}
+
+	void ScriptParseCache::_ensure_loaded() {
+		if (loaded)
+			return;
+		loaded = true;
+		if (_load() && entries.size())
+			revalidate_thread = Thread::create(_revalidate, this);
+	}
+
+	bool ScriptParseCache::_read(Map<String, Entry> &r_entries, const Set<String> *p_only) const {
+		FileAccess* f = FileAccess::open(cache_path, FileAccess::READ);
+		if (!f)
+			return false;
+		uint8_t magic[4];
+		String stamp;
+		f->get_buffer(magic, 4);
+		if (magic[0] != 'G' || magic[1] != 'D' || magic[2] != 'P' || magic[3] != 'C' ||
+				f->get_32() != FORMAT_VERSION || !_load_string(f, stamp) || stamp != _build_stamp) {
+			memdelete(f);
+			return false;
+		}
+		// Counts are checked against what is left of the file, a damaged one is dropped as a whole
+		Map<String, Entry> read;
+		bool valid = true;
+		uint32_t count = f->get_32();
+		if (!_fits(f, count, MIN_ENTRY_SIZE))
+			valid = false;
+		for (uint32_t i = 0; i < count && valid; i++) {
+			String path;
+			Entry e;
+			ScriptParseService::Result& r = e.result;
+			valid = _load_string(f, path);
+			if (!valid)
+				break;
+			e.mtime = f->get_64();
+			e.content_hash = f->get_32();
+			e.content_length = f->get_32();
+			r.valid = f->get_8();
+			r.is_tool = f->get_8();
+			valid = _load_string(f, r.base_class) && _load_string(f, r.native_calss);
+			uint32_t errors = valid ? f->get_32() : 0;
+			// Message length, row and column
+			valid = valid && _fits(f, errors, 12);
+			for (uint32_t j = 0; j < errors && valid; j++) {
+				ScriptParseService::Error err;
+				valid = _load_string(f, err.message);
+				err.row = int(f->get_32());
+				err.column = int(f->get_32());
+				r.errors.push_back(err);
+			}
+			valid = valid && _load_members(f, r.functions) && _load_members(f, r.members) &&
+					_load_members(f, r.signals) && _load_members(f, r.constants);
+			uint32_t dependencies = valid ? f->get_32() : 0;
+			valid = valid && _fits(f, dependencies, 4);
+			for (uint32_t j = 0; j < dependencies && valid; j++) {
+				String dependency;
+				valid = _load_string(f, dependency);
+				r.dependencies.push_back(dependency);
+			}
+			valid = valid && !f->eof_reached();
+			if (valid && (!p_only || p_only->has(path)))
+				read[path] = e;
+		}
+		memdelete(f);
+		if (!valid)
+			return false;
+		for (Map<String, Entry>::Element *E = read.front(); E; E = E->next())
+			r_entries[E->key()] = E->get();
+		return true;
+	}
+
+	bool ScriptParseCache::_load() {
+		Map<String, Entry> loaded_entries;
+		if (!_read(loaded_entries))
+			return false;
+		for (Map<String, Entry>::Element *E = loaded_entries.front(); E; E = E->next()) {
+			E->get().last_used = MemoryBudget::tick();
+			_insert(E->key(), E->get());
+		}
+		return true;
+	}
+
+	Error ScriptParseCache::save() {
+		// One writer at a time, the entries are copied so requests are not held up by the file
+		save_mutex->lock();
+		mutex->lock();
+		int saved = unsaved;
+		if (!saved) {
+			mutex->unlock();
+			save_mutex->unlock();
+			return OK;
+		}
+		Map<String, Entry> kept = entries;
+		Set<String> carried = evicted;
+		unsaved = 0;
+		mutex->unlock();
+
+		Error err = _write(kept, carried);
+		if (err != OK) {
+			mutex->lock();
+			unsaved += saved;
+			mutex->unlock();
+		}
+		save_mutex->unlock();
+		return err;
+	}
+
+	Error ScriptParseCache::_write(Map<String, Entry> &p_entries, const Set<String> &p_evicted) const {
+		DirAccess* dir = DirAccess::create_for_path(cache_path.get_base_dir());
+		if (dir) {
+			if (!dir->dir_exists(cache_path.get_base_dir()))
+				dir->make_dir_recursive(cache_path.get_base_dir());
+			memdelete(dir);
+		}
+		// Entries the budget dropped from memory are carried over from the previous file
+		if (p_evicted.size()) {
+			Map<String, Entry> previous;
+			_read(previous, &p_evicted);
+			for (Map<String, Entry>::Element *E = previous.front(); E; E = E->next()) {
+				if (!p_entries.has(E->key()))
+					p_entries[E->key()] = E->get();
+			}
+		}
+		// Written next to the cache and renamed over it, a crash leaves the previous file intact
+		String tmp_path = cache_path + ".tmp";
+		FileAccess* f = FileAccess::open(tmp_path, FileAccess::WRITE);
+		if (!f)
+			return ERR_CANT_CREATE;
+		f->store_buffer((const uint8_t*)"GDPC", 4);
+		f->store_32(FORMAT_VERSION);
+		f->store_pascal_string(_build_stamp);
+		f->store_32(p_entries.size());
+		for (Map<String, Entry>::Element *E = p_entries.front(); E; E = E->next()) {
+			const Entry& e = E->get();
+			const ScriptParseService::Result& r = e.result;
+			f->store_pascal_string(E->key());
+			f->store_64(e.mtime);
+			f->store_32(e.content_hash);
+			f->store_32(e.content_length);
+			f->store_8(r.valid);
+			f->store_8(r.is_tool);
+			f->store_pascal_string(r.base_class);
+			f->store_pascal_string(r.native_calss);
+			f->store_32(r.errors.size());
+			for (int i = 0; i < r.errors.size(); i++) {
+				f->store_pascal_string(r.errors[i].message);
+				f->store_32(r.errors[i].row);
+				f->store_32(r.errors[i].column);
+			}
+			_store_members(f, r.functions);
+			_store_members(f, r.members);
+			_store_members(f, r.signals);
+			_store_members(f, r.constants);
+			f->store_32(r.dependencies.size());
+			for (int i = 0; i < r.dependencies.size(); i++)
+				f->store_pascal_string(r.dependencies[i]);
+		}
+		f->close();
+		Error err = f->get_error();
+		memdelete(f);
+		if (err != OK)
+			return err;
+		return EditorServerService::replace_file(tmp_path, cache_path);
+	}
+
+	void ScriptParseCache::_save_in_background(void *p_self) {
+		ScriptParseCache* self = (ScriptParseCache*)p_self;
+		self->save();
+		self->mutex->lock();
+		self->saving = false;
+		self->mutex->unlock();
+	}
+
+	void ScriptParseCache::_revalidate(void *p_self) {
+		ScriptParseCache* self = (ScriptParseCache*)p_self;
+
+		self->mutex->lock();
+		Vector<String> paths;
+		Vector<uint64_t> mtimes;
+		for (Map<String, Entry>::Element *E = self->entries.front(); E; E = E->next()) {
+			paths.push_back(E->key());
+			mtimes.push_back(E->get().mtime);
+		}
+		self->mutex->unlock();
+
+		Set<String> stale_paths;
+		for (int i = 0; i < paths.size() && !self->quit; i++) {
+			bool stale = !FileAccess::exists(paths[i]);
+			uint64_t mtime = stale ? 0 : FileAccess::get_modified_time(paths[i]);
+			if (!stale && mtime != mtimes[i]) {
+				// Touched on disk, only the content decides whether the result still holds
+				Vector<uint8_t> bytes = FileAccess::get_file_as_array(paths[i]);
+				String text;
+				text.parse_utf8((const char*)bytes.ptr(), bytes.size());
+				self->mutex->lock();
+				Map<String, Entry>::Element *E = self->entries.find(paths[i]);
+				if (E) {
+					stale = E->get().content_hash != text.hash() || E->get().content_length != text.length();
+					if (!stale)
+						E->get().mtime = mtime;
+				}
+				self->mutex->unlock();
+			}
+			if (stale) {
+				self->mutex->lock();
+				Map<String, Entry>::Element *E = self->entries.find(paths[i]);
+				if (E) {
+					self->_erase(E);
+					self->unsaved++;
+				}
+				self->mutex->unlock();
+				stale_paths.insert(paths[i]);
+			}
+		}
+
+		// Scripts that extend or load a changed one were analyzed against its old version
+		self->mutex->lock();
+		bool dropped = stale_paths.size() > 0;
+		while (dropped) {
+			dropped = false;
+			Map<String, Entry>::Element *E = self->entries.front();
+			while (E) {
+				Map<String, Entry>::Element *N = E->next();
+				const Vector<String>& deps = E->get().result.dependencies;
+				for (int i = 0; i < deps.size(); i++) {
+					if (stale_paths.has(deps[i])) {
+						stale_paths.insert(E->key());
+						self->_erase(E);
+						self->unsaved++;
+						dropped = true;
+						break;
+					}
+				}
+				E = N;
+			}
+		}
+		self->mutex->unlock();
+	}
+
+	bool ScriptParseCache::get(const String &p_path, const String &p_text, ScriptParseService::Result &r_result) {
+		mutex->lock();
+		_ensure_loaded();
+		bool found = false;
+		Map<String, Entry>::Element *E = entries.find(p_path);
+		if (E && E->get().content_length == p_text.length() && E->get().content_hash == p_text.hash()) {
+			E->get().last_used = MemoryBudget::tick();
+			lru.move_to_back(E->get().lru);
+			r_result = E->get().result;
+			found = true;
+		}
+		mutex->unlock();
+		return found;
+	}
+
+	void ScriptParseCache::put(const String &p_path, const String &p_text, const ScriptParseService::Result &p_result) {
+		Entry e;
+		e.mtime = FileAccess::get_modified_time(p_path);
+		e.content_hash = p_text.hash();
+		e.content_length = p_text.length();
+		e.result = p_result;
+		e.last_used = MemoryBudget::tick();
+
+		mutex->lock();
+		_ensure_loaded();
+		_insert(p_path, e);
+		// Flushed by a thread of its own, a request never waits for the file
+		Thread *finished = nullptr;
+		bool flush = ++unsaved >= SAVE_THRESHOLD && !saving && !quit;
+		if (flush) {
+			saving = true;
+			finished = save_thread;
+			save_thread = nullptr;
+		}
+		mutex->unlock();
+		MemoryBudget::enforce();
+		if (flush) {
+			if (finished) {
+				// Already past its save, this only reclaims the thread
+				Thread::wait_to_finish(finished);
+				memdelete(finished);
+			}
+			// Created under the lock, the thread cannot clear saving before it is recorded
+			mutex->lock();
+			save_thread = Thread::create(_save_in_background, this);
+			mutex->unlock();
+		}
+	}
+
+	void ScriptParseCache::invalidate(const String &p_path) {
+		mutex->lock();
+		Map<String, Entry>::Element *E = entries.find(p_path);
+		if (E)
+			_erase(E);
+		// The copy in the file is stale as well
+		if (E || evicted.erase(p_path))
+			unsaved++;
+		mutex->unlock();
+	}
+
+	int64_t ScriptParseCache::get_memory_usage() const {
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	uint64_t ScriptParseCache::get_oldest_use() const {
+		mutex->lock();
+		uint64_t oldest = lru.front() ? entries[lru.front()->get()].last_used : 0;
+		mutex->unlock();
+		return oldest;
+	}
+
+	int64_t ScriptParseCache::evict_oldest() {
+		int64_t freed = 0;
+		mutex->lock();
+		Map<String, Entry>::Element *E = lru.front() ? entries.find(lru.front()->get()) : nullptr;
+		if (E) {
+			freed = _size_of(E->key(), E->get());
+			evicted.insert(E->key());
+			_erase(E);
+		}
+		mutex->unlock();
+		return freed;
+	}
+
+}
@@ -0,0 +1,78 @@
+#ifndef GD_EXPLORER_PARSE_CACHE_H
+#define GD_EXPLORER_PARSE_CACHE_H
+
+#include "script_parse_service.h"
+#include <core/os/mutex.h>
+#include <core/os/thread.h>
+#include <core/set.h>
+#include "../memory_budget.h"
+
+namespace gdexplorer {
+
+	// Parse results kept across editor sessions, keyed by script path and validated by content hash
+	class ScriptParseCache : public MemoryBudget::Consumer {
+	public:
+		enum {
+			FORMAT_VERSION = 2,
+			// Unsaved entries written out together rather than one file write per parse
+			SAVE_THRESHOLD = 64,
+			// Bytes of an entry with empty strings and no errors, members or dependencies
+			MIN_ENTRY_SIZE = 54,
+		};
+
+		struct Entry {
+			uint64_t mtime = 0;
+			uint32_t content_hash = 0;
+			int content_length = 0;
+			uint64_t last_used = 0;
+			List<String>::Element* lru = nullptr;
+			ScriptParseService::Result result;
+		};
+
+	private:
+		Map<String, Entry> entries;
+		// Paths of the entries from least to most recently used
+		List<String> lru;
+		// Dropped from memory by the budget, their results stay in the cache file
+		Set<String> evicted;
+		Mutex *mutex;
+		// Held for a whole save so two writers never race on the file
+		Mutex *save_mutex;
+		Thread *revalidate_thread = nullptr;
+		Thread *save_thread = nullptr;
+		String cache_path;
+		bool loaded = false;
+		bool quit = false;
+		bool saving = false;
+		int unsaved = 0;
+		int64_t memory = 0;
+
+		static int64_t _size_of(const String& p_path, const Entry& p_entry);
+		void _insert(const String& p_path, Entry& p_entry);
+		void _erase(Map<String, Entry>::Element* p_entry);
+		void _ensure_loaded();
+		// Reads the cache file, only the entries in p_only when given
+		bool _read(Map<String, Entry>& r_entries, const Set<String>* p_only = nullptr) const;
+		bool _load();
+		// Writes p_entries plus the p_evicted ones still in the old file, then replaces it
+		Error _write(Map<String, Entry>& p_entries, const Set<String>& p_evicted) const;
+		static void _revalidate(void *p_self);
+		static void _save_in_background(void *p_self);
+	public:
+		bool get(const String& p_path, const String& p_text, ScriptParseService::Result& r_result);
+		void put(const String& p_path, const String& p_text, const ScriptParseService::Result& p_result);
+		void invalidate(const String& p_path);
+		Error save();
+
+		// Evictions only drop the copy in memory, the cache file keeps them for the next session
+		virtual int64_t get_memory_usage() const override;
+		virtual uint64_t get_oldest_use() const override;
+		virtual int64_t evict_oldest() override;
+
+		ScriptParseCache(const String& p_cache_path = "res://.vscode/parse_cache.bin");
+		~ScriptParseCache();
+	};
+
+}
+
+#endif // GD_EXPLORER_PARSE_CACHE_H
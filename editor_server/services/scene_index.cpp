@@ -0,0 +1,491 @@
+#include "scene_index.h"
+#include <core/os/os.h>
+#include <core/os/dir_access.h>
+#include <core/io/json.h>
+#include <core/globals.h>
+#include "../json_writer.h"
+#include "../trace.h"
+
+namespace gdexplorer {
+
+	// Flips p_in_string for every unescaped quote, multi-line strings may hold text that looks like a section
+	static bool _string_state(const String& p_text, bool p_in_string) {
+		for (int i = 0; i < p_text.length(); i++) {
+			CharType c = p_text[i];
+			if (p_in_string && c == '\\')
+				i++;
+			else if (c == '"')
+				p_in_string = !p_in_string;
+		}
+		return p_in_string;
+	}
+
+	// Splits "[tag key=value ...]" into the tag and its attributes, quoted values are unquoted
+	static bool _parse_section(const String& p_line, String& r_tag, Map<String, String>& r_attributes) {
+		int len = p_line.length();
+		int pos = 1;
+		while (pos < len && p_line[pos] != ' ' && p_line[pos] != ']')
+			pos++;
+		r_tag = p_line.substr(1, pos - 1);
+		if (r_tag.empty())
+			return false;
+		while (pos < len && p_line[pos] != ']') {
+			while (pos < len && p_line[pos] == ' ')
+				pos++;
+			int eq = pos;
+			while (eq < len && p_line[eq] != '=' && p_line[eq] != ']')
+				eq++;
+			if (eq >= len || p_line[eq] != '=')
+				break;
+			String key = p_line.substr(pos, eq - pos).strip_edges();
+			pos = eq + 1;
+			String value;
+			if (pos < len && p_line[pos] == '"') {
+				pos++;
+				while (pos < len && p_line[pos] != '"') {
+					if (p_line[pos] == '\\' && pos + 1 < len)
+						pos++;
+					value += p_line[pos];
+					pos++;
+				}
+				pos++;
+			} else {
+				// Bare values like ExtResource( 1 ) may contain spaces inside the parentheses
+				int depth = 0;
+				int from = pos;
+				while (pos < len) {
+					CharType c = p_line[pos];
+					if (c == '(')
+						depth++;
+					else if (c == ')')
+						depth--;
+					else if (depth <= 0 && (c == ' ' || c == ']'))
+						break;
+					pos++;
+				}
+				value = p_line.substr(from, pos - from);
+			}
+			r_attributes[key] = value;
+		}
+		return true;
+	}
+
+	String SceneIndex::_resolve_ext(const Scene &p_scene, const String &p_value) {
+		if (!p_value.begins_with("ExtResource"))
+			return String();
+		int from = p_value.find("(");
+		int to = p_value.find_last(")");
+		if (from < 0 || to <= from)
+			return String();
+		int id = p_value.substr(from + 1, to - from - 1).strip_edges().to_int();
+		for (int i = 0; i < p_scene.ext_resources.size(); i++) {
+			if (p_scene.ext_resources[i].id == id)
+				return p_scene.ext_resources[i].path;
+		}
+		return String();
+	}
+
+	Error SceneIndex::parse(FileAccess *p_file, Scene &r_scene) {
+		ERR_FAIL_COND_V(!p_file, ERR_INVALID_PARAMETER);
+		bool in_string = false;
+		bool in_resource = false;
+		int node = -1;
+		while (!p_file->eof_reached()) {
+			String line = p_file->get_line();
+			if (in_string) {
+				in_string = _string_state(line, true);
+				continue;
+			}
+			line = line.strip_edges();
+			if (line.empty() || line[0] == ';')
+				continue;
+
+			if (line[0] == '[' && line.length() > 1 && line[1] != ' ') {
+				String tag;
+				Map<String, String> attributes;
+				if (!_parse_section(line, tag, attributes))
+					continue;
+				node = -1;
+				in_resource = false;
+				if (tag == "gd_resource") {
+					if (attributes.has("type"))
+						r_scene.resource_type = attributes["type"];
+				} else if (tag == "ext_resource") {
+					ExtResource ext;
+					ext.id = attributes.has("id") ? attributes["id"].to_int() : 0;
+					ext.path = attributes.has("path") ? attributes["path"] : String();
+					ext.type = attributes.has("type") ? attributes["type"] : String();
+					r_scene.ext_resources.push_back(ext);
+				} else if (tag == "node") {
+					Node n;
+					n.name = attributes.has("name") ? attributes["name"] : String();
+					n.type = attributes.has("type") ? attributes["type"] : String();
+					if (attributes.has("instance"))
+						n.instance = _resolve_ext(r_scene, attributes["instance"]);
+					if (!attributes.has("parent"))
+						n.path = ".";
+					else if (attributes["parent"] == ".")
+						n.path = n.name;
+					else
+						n.path = attributes["parent"] + "/" + n.name;
+					r_scene.nodes.push_back(n);
+					node = r_scene.nodes.size() - 1;
+				} else if (tag == "resource") {
+					in_resource = true;
+				}
+				continue;
+			}
+
+			int eq = line.find("=");
+			if (eq <= 0)
+				continue;
+			String value = line.substr(eq + 1, line.length()).strip_edges();
+			if (line.substr(0, eq).strip_edges() == "script") {
+				String script = _resolve_ext(r_scene, value);
+				if (node >= 0)
+					r_scene.nodes[node].script = script;
+				else if (in_resource)
+					r_scene.script = script;
+			}
+			in_string = _string_state(value, false);
+		}
+		return OK;
+	}
+
+	SceneIndex::SceneIndex(int p_refresh_interval_msec): refresh_interval_msec(p_refresh_interval_msec) {
+		mutex = Mutex::create();
+		MemoryBudget::add("scene_index", this);
+	}
+
+	SceneIndex::~SceneIndex() {
+		MemoryBudget::remove(this);
+		memdelete(mutex);
+	}
+
+	int64_t SceneIndex::_size_of(const String &p_path, const Scene &p_scene) {
+		int64_t bytes = sizeof(Scene) + MemoryBudget::size_of(p_path) + MemoryBudget::size_of(p_scene.resource_type) + MemoryBudget::size_of(p_scene.script);
+		for (int i = 0; i < p_scene.ext_resources.size(); i++) {
+			const ExtResource& ext = p_scene.ext_resources[i];
+			bytes += sizeof(ExtResource) + MemoryBudget::size_of(ext.path) + MemoryBudget::size_of(ext.type);
+		}
+		for (int i = 0; i < p_scene.nodes.size(); i++) {
+			const Node& node = p_scene.nodes[i];
+			bytes += sizeof(Node) + MemoryBudget::size_of(node.name) + MemoryBudget::size_of(node.type) + MemoryBudget::size_of(node.path);
+			bytes += MemoryBudget::size_of(node.script) + MemoryBudget::size_of(node.instance);
+		}
+		return bytes;
+	}
+
+	bool SceneIndex::_erase(const String &p_path) {
+		Map<String, Scene>::Element *E = scenes.find(p_path);
+		if (!E)
+			return false;
+		memory -= _size_of(p_path, E->get());
+		scenes.erase(E);
+		return true;
+	}
+
+	void SceneIndex::_scan(const String &p_dir, Map<String, uint64_t> &r_files) const {
+		DirAccess* dir = DirAccess::open(p_dir);
+		if (!dir)
+			return;
+		Vector<String> subdirs;
+		dir->list_dir_begin();
+		String name = dir->get_next();
+		while (name != "") {
+			// Skips the navigation entries and hidden folders like .import and .vscode
+			if (!name.begins_with(".")) {
+				String path = p_dir.plus_file(name);
+				if (dir->current_is_dir())
+					subdirs.push_back(path);
+				else if (name.ends_with(".tscn") || name.ends_with(".tres"))
+					r_files[path] = FileAccess::get_modified_time(path);
+			}
+			name = dir->get_next();
+		}
+		dir->list_dir_end();
+		memdelete(dir);
+		for (int i = 0; i < subdirs.size(); i++)
+			_scan(subdirs[i], r_files);
+	}
+
+	void SceneIndex::refresh(bool p_force) {
+		uint64_t now = OS::get_singleton()->get_ticks_msec();
+		mutex->lock();
+		if (!p_force && last_refresh && now - last_refresh < uint64_t(refresh_interval_msec)) {
+			mutex->unlock();
+			return;
+		}
+		// Claimed before scanning so concurrent queries answer from what is indexed
+		last_refresh = now;
+		mutex->unlock();
+
+		EDITOR_SERVER_TRACE("scene index refresh");
+		Map<String, uint64_t> files;
+		_scan("res://", files);
+
+		Vector<String> removed;
+		mutex->lock();
+		for (Map<String, Scene>::Element *E = scenes.front(); E; E = E->next()) {
+			if (!files.has(E->key()))
+				removed.push_back(E->key());
+		}
+		for (int i = 0; i < removed.size(); i++)
+			_erase(removed[i]);
+		if (removed.size())
+			version++;
+		mutex->unlock();
+
+		for (Map<String, uint64_t>::Element *E = files.front(); E; E = E->next()) {
+			mutex->lock();
+			const Map<String, Scene>::Element *S = scenes.find(E->key());
+			bool changed = !S || S->get().mtime != E->get();
+			mutex->unlock();
+			if (changed)
+				update(E->key());
+		}
+	}
+
+	void SceneIndex::update(const String &p_path) {
+		FileAccess* f = FileAccess::open(p_path, FileAccess::READ);
+		if (!f) {
+			remove(p_path);
+			return;
+		}
+		Scene scene;
+		scene.mtime = FileAccess::get_modified_time(p_path);
+		Error err = parse(f, scene);
+		memdelete(f);
+		if (err != OK)
+			return;
+		int64_t bytes = _size_of(p_path, scene);
+		mutex->lock();
+		_erase(p_path);
+		scenes[p_path] = scene;
+		memory += bytes;
+		version++;
+		mutex->unlock();
+		MemoryBudget::enforce();
+	}
+
+	void SceneIndex::remove(const String &p_path) {
+		mutex->lock();
+		if (_erase(p_path))
+			version++;
+		mutex->unlock();
+	}
+
+	bool SceneIndex::get_scene(const String &p_path, Scene &r_scene) const {
+		mutex->lock();
+		const Map<String, Scene>::Element *E = scenes.find(p_path);
+		if (E)
+			r_scene = E->get();
+		mutex->unlock();
+		return E != nullptr;
+	}
+
+	void SceneIndex::get_scenes_with_script(const String &p_script, Map<String, Scene> &r_scenes) const {
+		mutex->lock();
+		for (const Map<String, Scene>::Element *E = scenes.front(); E; E = E->next()) {
+			const Vector<Node>& nodes = E->get().nodes;
+			for (int i = 0; i < nodes.size(); i++) {
+				if (nodes[i].script == p_script) {
+					r_scenes[E->key()] = E->get();
+					break;
+				}
+			}
+		}
+		mutex->unlock();
+	}
+
+	void SceneIndex::get_paths(const String &p_prefix, Set<String> &r_paths) const {
+		mutex->lock();
+		for (const Map<String, Scene>::Element *E = scenes.front(); E; E = E->next()) {
+			if (E->key().begins_with(p_prefix))
+				r_paths.insert(E->key());
+			const Vector<ExtResource>& ext = E->get().ext_resources;
+			for (int i = 0; i < ext.size(); i++) {
+				if (ext[i].path.begins_with(p_prefix))
+					r_paths.insert(ext[i].path);
+			}
+		}
+		mutex->unlock();
+	}
+
+	uint64_t SceneIndex::get_version() const {
+		mutex->lock();
+		uint64_t v = version;
+		mutex->unlock();
+		return v;
+	}
+
+	int64_t SceneIndex::get_memory_usage() const {
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	int SceneIndex::get_scene_count() const {
+		mutex->lock();
+		int count = scenes.size();
+		mutex->unlock();
+		return count;
+	}
+
+	SceneIndexService::Request::Request(const Dictionary &request) {
+		query = request.has("query")? request["query"]:"scene";
+		path = request.has("path")? request["path"]:"";
+		if (!path.empty())
+			path = GlobalConfig::get_singleton()->localize_path(path);
+		prefix = request.has("prefix")? request["prefix"]:"res://";
+	}
+
+	SceneIndexService::SceneIndexService() {
+		index = memnew(SceneIndex);
+	}
+
+	SceneIndexService::~SceneIndexService() {
+		memdelete(index);
+	}
+
+	static void _write_node(JSONWriter& p_writer, const SceneIndex::Node& p_node, const String& p_path) {
+		p_writer.begin_object();
+		p_writer.key("path");
+		p_writer.value(p_path);
+		p_writer.key("name");
+		p_writer.value(p_node.name);
+		p_writer.key("type");
+		p_writer.value(p_node.type);
+		if (!p_node.script.empty()) {
+			p_writer.key("script");
+			p_writer.value(p_node.script);
+		}
+		if (!p_node.instance.empty()) {
+			p_writer.key("instance");
+			p_writer.value(p_node.instance);
+		}
+		p_writer.end_object();
+	}
+
+	void SceneIndexService::_write_result(JSONWriter &p_writer, const Request &p_request) const {
+		index->refresh();
+		p_writer.begin_object();
+		if (p_request.query == "scene") {
+			SceneIndex::Scene scene;
+			bool found = index->get_scene(p_request.path, scene);
+			p_writer.key("found");
+			p_writer.value(found);
+			if (found) {
+				if (!scene.resource_type.empty()) {
+					p_writer.key("type");
+					p_writer.value(scene.resource_type);
+				}
+				if (!scene.script.empty()) {
+					p_writer.key("script");
+					p_writer.value(scene.script);
+				}
+				p_writer.key("ext_resources");
+				p_writer.begin_array();
+				for (int i = 0; i < scene.ext_resources.size(); i++) {
+					p_writer.begin_object();
+					p_writer.key("id");
+					p_writer.value(scene.ext_resources[i].id);
+					p_writer.key("path");
+					p_writer.value(scene.ext_resources[i].path);
+					p_writer.key("type");
+					p_writer.value(scene.ext_resources[i].type);
+					p_writer.end_object();
+				}
+				p_writer.end_array();
+				p_writer.key("nodes");
+				p_writer.begin_array();
+				for (int i = 0; i < scene.nodes.size(); i++)
+					_write_node(p_writer, scene.nodes[i], scene.nodes[i].path);
+				p_writer.end_array();
+			}
+		} else if (p_request.query == "script") {
+			// Every node carrying the script with the paths get_node() accepts from it
+			Map<String, SceneIndex::Scene> scenes;
+			index->get_scenes_with_script(p_request.path, scenes);
+			p_writer.key("scenes");
+			p_writer.begin_object();
+			for (Map<String, SceneIndex::Scene>::Element *E = scenes.front(); E; E = E->next()) {
+				const Vector<SceneIndex::Node>& nodes = E->get().nodes;
+				p_writer.key(E->key());
+				p_writer.begin_array();
+				for (int i = 0; i < nodes.size(); i++) {
+					if (nodes[i].script != p_request.path)
+						continue;
+					const String& owner = nodes[i].path;
+					p_writer.begin_object();
+					p_writer.key("node");
+					p_writer.value(owner);
+					p_writer.key("children");
+					p_writer.begin_array();
+					for (int j = 0; j < nodes.size(); j++) {
+						const String& path = nodes[j].path;
+						if (owner == ".") {
+							if (path != ".")
+								_write_node(p_writer, nodes[j], path);
+						} else if (path.begins_with(owner + "/")) {
+							_write_node(p_writer, nodes[j], path.substr(owner.length() + 1, path.length()));
+						}
+					}
+					p_writer.end_array();
+					p_writer.end_object();
+				}
+				p_writer.end_array();
+			}
+			p_writer.end_object();
+		} else if (p_request.query == "resources") {
+			Set<String> paths;
+			index->get_paths(p_request.prefix, paths);
+			p_writer.key("paths");
+			p_writer.begin_array();
+			for (Set<String>::Element *E = paths.front(); E; E = E->next())
+				p_writer.value(E->get());
+			p_writer.end_array();
+		}
+		p_writer.end_object();
+	}
+
+	String SceneIndexService::get_etag(const Dictionary &data) const {
+		if (get_script_instance())
+			return String();
+		index->refresh();
+		return itos(index->get_version());
+	}
+
+	bool SceneIndexService::resolve_stream(const Dictionary &_data, JSONWriter &p_writer) const {
+		if (get_script_instance())
+			return false;
+		Request request(_data["request"]);
+		p_writer.begin_object();
+		write_fields(p_writer, _data, "result");
+		p_writer.key("result");
+		_write_result(p_writer, request);
+		p_writer.end_object();
+		return true;
+	}
+
+	Dictionary SceneIndexService::resolve(const Dictionary &_data) const {
+		Dictionary data(_data);
+		Request request(data["request"]);
+
+		JSONBufferSink sink;
+		{
+			JSONWriter writer(&sink);
+			_write_result(writer, request);
+		}
+		Variant result;
+		String errmsg;
+		int errline = -1;
+		String json;
+		json.parse_utf8((const char*)sink.ptr(), sink.size());
+		if (JSON::parse(json, result, errmsg, errline) == OK)
+			data["result"] = result;
+		return super::resolve(data);
+	}
+
+}
@@ -0,0 +1,106 @@
+#ifndef GD_EXPLORER_SCENE_INDEX_H
+#define GD_EXPLORER_SCENE_INDEX_H
+
+#include "service.h"
+#include <core/os/mutex.h>
+#include <core/os/file_access.h>
+#include "../memory_budget.h"
+
+namespace gdexplorer {
+
+	// Node trees and external resources of the project's .tscn and .tres files, read as text without loading them
+	class SceneIndex : public MemoryBudget::Consumer {
+	public:
+		struct ExtResource {
+			int id = 0;
+			String path;
+			String type;
+		};
+
+		struct Node {
+			String name;
+			String type;
+			// Relative to the scene root, "." for the root itself
+			String path;
+			String script;
+			// Scene the node instances
+			String instance;
+		};
+
+		struct Scene {
+			uint64_t mtime = 0;
+			// Resource type of a .tres, empty for scenes
+			String resource_type;
+			String script;
+			Vector<ExtResource> ext_resources;
+			Vector<Node> nodes;
+		};
+
+	private:
+		Map<String, Scene> scenes;
+		Mutex *mutex;
+		uint64_t last_refresh = 0;
+		uint64_t version = 0;
+		int64_t memory = 0;
+		int refresh_interval_msec;
+
+		void _scan(const String& p_dir, Map<String, uint64_t>& r_files) const;
+		static int64_t _size_of(const String& p_path, const Scene& p_scene);
+		bool _erase(const String& p_path);
+		static String _resolve_ext(const Scene& p_scene, const String& p_value);
+	public:
+		// Reads one file line by line, only section headers and script properties are looked at
+		static Error parse(FileAccess* p_file, Scene& r_scene);
+
+		// Reparses files whose modification time changed and drops deleted ones.
+		// Unless forced, does nothing when the last refresh is more recent than the interval
+		void refresh(bool p_force = false);
+		void update(const String& p_path);
+		void remove(const String& p_path);
+
+		bool get_scene(const String& p_path, Scene& r_scene) const;
+		// Scenes with at least one node that has p_script attached
+		void get_scenes_with_script(const String& p_script, Map<String, Scene>& r_scenes) const;
+		// Indexed files and the resources they reference, starting with p_prefix
+		void get_paths(const String& p_prefix, Set<String>& r_paths) const;
+		int get_scene_count() const;
+		// Changes whenever a file is added, reparsed or dropped
+		uint64_t get_version() const;
+		// Counted against the memory budget, never evicted since queries need every scene
+		virtual int64_t get_memory_usage() const override;
+
+		SceneIndex(int p_refresh_interval_msec = 1000);
+		~SceneIndex();
+	};
+
+	class SceneIndexService : public EditorServerService {
+		GDCLASS(SceneIndexService, EditorServerService);
+		using super = EditorServerService;
+	public:
+		struct Request {
+			// "scene", "script" or "resources"
+			String query;
+			String path;
+			String prefix;
+			Request(const Dictionary& dict);
+		};
+
+	protected:
+		SceneIndex *index;
+		void _write_result(JSONWriter& p_writer, const Request& p_request) const;
+	public:
+		SceneIndex* get_index() const { return index; }
+
+		virtual Dictionary resolve(const Dictionary& _data) const override;
+		virtual bool resolve_stream(const Dictionary& _data, JSONWriter& p_writer) const override;
+		// NodePath and preload completion
+		virtual Priority get_priority() const override { return PRIORITY_INTERACTIVE; }
+		virtual bool can_coalesce(const Dictionary& data) const override { return true; }
+		virtual String get_etag(const Dictionary& data) const override;
+		SceneIndexService();
+		virtual ~SceneIndexService();
+	};
+
+}
+
+#endif // GD_EXPLORER_SCENE_INDEX_H
@@ -0,0 +1,184 @@
+#include "script_dependencies.h"
+
+namespace gdexplorer {
+
+	Mutex *ScriptDependencies::mutex = nullptr;
+	Map<String, ScriptDependencies::Node> ScriptDependencies::nodes;
+	Vector<ScriptDependencies::Listener> ScriptDependencies::listeners;
+
+	void ScriptDependencies::initialize() {
+		if (!mutex)
+			mutex = Mutex::create();
+	}
+
+	void ScriptDependencies::finalize() {
+		if (mutex) {
+			nodes.clear();
+			listeners.clear();
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	void ScriptDependencies::add_listener(InvalidateFunc p_func, void *p_userdata) {
+		ERR_FAIL_COND(!mutex);
+		Listener l;
+		l.func = p_func;
+		l.userdata = p_userdata;
+		mutex->lock();
+		listeners.push_back(l);
+		mutex->unlock();
+	}
+
+	void ScriptDependencies::remove_listener(InvalidateFunc p_func, void *p_userdata) {
+		// Services may outlive the graph
+		if (!mutex)
+			return;
+		mutex->lock();
+		for (int i = 0; i < listeners.size(); i++) {
+			if (listeners[i].func == p_func && listeners[i].userdata == p_userdata) {
+				listeners.remove(i);
+				break;
+			}
+		}
+		mutex->unlock();
+	}
+
+	void ScriptDependencies::_unlink(const String &p_path, Node &r_node) {
+		for (Set<String>::Element *E = r_node.dependencies.front(); E; E = E->next()) {
+			Map<String, Node>::Element *D = nodes.find(E->get());
+			if (!D)
+				continue;
+			D->get().dependents.erase(p_path);
+			_prune(E->get());
+		}
+		r_node.dependencies.clear();
+	}
+
+	void ScriptDependencies::_prune(const String &p_path) {
+		// Nodes that only stood for a missing end of an edge
+		Map<String, Node>::Element *E = nodes.find(p_path);
+		if (E && !E->get().has_content && E->get().dependencies.empty() && E->get().dependents.empty())
+			nodes.erase(E);
+	}
+
+	void ScriptDependencies::_collect_dependents(const String &p_path, Set<String> &r_dependents) {
+		List<String> pending;
+		pending.push_back(p_path);
+		while (pending.size()) {
+			String path = pending.front()->get();
+			pending.pop_front();
+			const Map<String, Node>::Element *E = nodes.find(path);
+			if (!E)
+				continue;
+			for (const Set<String>::Element *D = E->get().dependents.front(); D; D = D->next()) {
+				// Cycles end at scripts already visited
+				if (D->get() == p_path || r_dependents.has(D->get()))
+					continue;
+				r_dependents.insert(D->get());
+				pending.push_back(D->get());
+			}
+		}
+	}
+
+	void ScriptDependencies::_invalidate_dependents(const String &p_path) {
+		Set<String> dependents;
+		mutex->lock();
+		_collect_dependents(p_path, dependents);
+		for (Set<String>::Element *E = dependents.front(); E; E = E->next())
+			nodes[E->get()].generation++;
+		Vector<Listener> notify = listeners;
+		mutex->unlock();
+
+		for (Set<String>::Element *E = dependents.front(); E; E = E->next()) {
+			for (int i = 0; i < notify.size(); i++)
+				notify[i].func(notify[i].userdata, E->get());
+		}
+	}
+
+	void ScriptDependencies::update(const String &p_path, uint32_t p_content_hash, const Vector<String> &p_dependencies) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		Node& node = nodes[p_path];
+		bool changed = node.has_content && node.content_hash != p_content_hash;
+		node.has_content = true;
+		node.content_hash = p_content_hash;
+		_unlink(p_path, node);
+		for (int i = 0; i < p_dependencies.size(); i++) {
+			if (p_dependencies[i] == p_path)
+				continue;
+			node.dependencies.insert(p_dependencies[i]);
+			// The reference stays valid, Map does not move its elements
+			nodes[p_dependencies[i]].dependents.insert(p_path);
+		}
+		mutex->unlock();
+		if (changed)
+			_invalidate_dependents(p_path);
+	}
+
+	void ScriptDependencies::touch(const String &p_path, uint32_t p_content_hash) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		Map<String, Node>::Element *E = nodes.find(p_path);
+		bool changed = E && E->get().has_content && E->get().content_hash != p_content_hash;
+		if (changed)
+			E->get().content_hash = p_content_hash;
+		mutex->unlock();
+		if (changed)
+			_invalidate_dependents(p_path);
+	}
+
+	void ScriptDependencies::remove(const String &p_path) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		Map<String, Node>::Element *E = nodes.find(p_path);
+		if (!E) {
+			mutex->unlock();
+			return;
+		}
+		_unlink(p_path, E->get());
+		E->get().has_content = false;
+		mutex->unlock();
+		_invalidate_dependents(p_path);
+		mutex->lock();
+		_prune(p_path);
+		mutex->unlock();
+	}
+
+	void ScriptDependencies::get_dependencies(const String &p_path, Vector<String> &r_dependencies) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		const Map<String, Node>::Element *E = nodes.find(p_path);
+		if (E) {
+			for (const Set<String>::Element *D = E->get().dependencies.front(); D; D = D->next())
+				r_dependencies.push_back(D->get());
+		}
+		mutex->unlock();
+	}
+
+	void ScriptDependencies::get_dependents(const String &p_path, bool p_transitive, Vector<String> &r_dependents) {
+		ERR_FAIL_COND(!mutex);
+		Set<String> dependents;
+		mutex->lock();
+		if (p_transitive) {
+			_collect_dependents(p_path, dependents);
+		} else {
+			const Map<String, Node>::Element *E = nodes.find(p_path);
+			if (E)
+				dependents = E->get().dependents;
+		}
+		mutex->unlock();
+		for (Set<String>::Element *E = dependents.front(); E; E = E->next())
+			r_dependents.push_back(E->get());
+	}
+
+	uint32_t ScriptDependencies::get_generation(const String &p_path) {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		const Map<String, Node>::Element *E = nodes.find(p_path);
+		uint32_t generation = E ? E->get().generation : 0;
+		mutex->unlock();
+		return generation;
+	}
+
+}
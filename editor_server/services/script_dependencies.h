@@ -0,0 +1,64 @@
+#ifndef GD_EXPLORER_SCRIPT_DEPENDENCIES_H
+#define GD_EXPLORER_SCRIPT_DEPENDENCIES_H
+
+#include <core/ustring.h>
+#include <core/map.h>
+#include <core/set.h>
+#include <core/vector.h>
+#include <core/os/mutex.h>
+
+namespace gdexplorer {
+
+	// Which scripts extend, preload or load which resources, built from parse results as they come in.
+	// A changed script invalidates its transitive dependents in every cache that registered a listener
+	class ScriptDependencies {
+	public:
+		// Called outside the graph's lock, once per invalidated path
+		typedef void (*InvalidateFunc)(void* p_userdata, const String& p_path);
+
+	private:
+		struct Node {
+			bool has_content = false;
+			uint32_t content_hash = 0;
+			uint32_t generation = 0;
+			Set<String> dependencies;
+			Set<String> dependents;
+		};
+
+		struct Listener {
+			InvalidateFunc func;
+			void* userdata;
+		};
+
+		static Mutex *mutex;
+		static Map<String, Node> nodes;
+		static Vector<Listener> listeners;
+
+		static void _unlink(const String& p_path, Node& r_node);
+		static void _prune(const String& p_path);
+		static void _collect_dependents(const String& p_path, Set<String>& r_dependents);
+		// Takes the lock, bumps the generations and notifies the listeners after releasing it
+		static void _invalidate_dependents(const String& p_path);
+	public:
+		static void initialize();
+		static void finalize();
+
+		static void add_listener(InvalidateFunc p_func, void* p_userdata);
+		static void remove_listener(InvalidateFunc p_func, void* p_userdata);
+
+		// Replaces what p_path depends on and records its content
+		static void update(const String& p_path, uint32_t p_content_hash, const Vector<String>& p_dependencies);
+		// Content of p_path seen outside a parse, dependents are invalidated when it differs from the last one
+		static void touch(const String& p_path, uint32_t p_content_hash);
+		// p_path was deleted
+		static void remove(const String& p_path);
+
+		static void get_dependencies(const String& p_path, Vector<String>& r_dependencies);
+		static void get_dependents(const String& p_path, bool p_transitive, Vector<String>& r_dependents);
+		// Bumped whenever a change of something p_path depends on invalidates it
+		static uint32_t get_generation(const String& p_path);
+	};
+
+}
+
+#endif // GD_EXPLORER_SCRIPT_DEPENDENCIES_H
@@ -1,49 +1,221 @@
 #include "script_parse_service.h"
 #include <core/globals.h>
 #include <core/script_language.h>
-#include <io/resource_loader.h>
 #include <tools/editor/editor_node.h>
 #include <core/array.h>
+#include "../json_writer.h"
+#include "../json_reader.h"
+#include "parse_cache.h"
+#include "../trace.h"
+#include "source_cache.h"
+#include "script_dependencies.h"
 #ifdef GDSCRIPT_ENABLED
 #include "modules/gdscript/gd_parser.h"
 #include "modules/gdscript/gd_compiler.h"
+#include "modules/gdscript/gd_tokenizer.h"
 #endif
 
 namespace gdexplorer {
 
+#ifdef GDSCRIPT_ENABLED
+	namespace {
+		// Parser and compiler of a worker thread, reused by every parse that runs on it
+		struct ParseContext {
+			GDParser parser;
+			GDCompiler compiler;
+		};
+		struct ThreadParseContext {
+			ParseContext* context = nullptr;
+			~ThreadParseContext() {
+				if (context)
+					memdelete(context);
+			}
+		};
+		thread_local ThreadParseContext _thread_context;
+
+		ParseContext* _get_parse_context() {
+			if (!_thread_context.context)
+				_thread_context.context = memnew(ParseContext);
+			return _thread_context.context;
+		}
+
+		// Drops the syntax tree once the request is answered, a parse also starts with a clear
+		struct ParserReset {
+			GDParser& parser;
+			ParserReset(GDParser& p_parser): parser(p_parser) {}
+			~ParserReset() { parser.clear(); }
+		};
+
+		// Resources named by extends, preload() and load() with a constant path, resolved like the parser does
+		void _collect_dependencies(const String& p_text, const String& p_base_dir, Vector<String>& r_dependencies) {
+			GDTokenizerText tokenizer;
+			tokenizer.set_code(p_text);
+			Set<String> found;
+			while (tokenizer.get_token() != GDTokenizer::TK_EOF && tokenizer.get_token() != GDTokenizer::TK_ERROR) {
+				int path_offset = -1;
+				GDTokenizer::Token token = tokenizer.get_token();
+				if (token == GDTokenizer::TK_PR_EXTENDS)
+					path_offset = 1;
+				else if ((token == GDTokenizer::TK_PR_PRELOAD ||
+						(token == GDTokenizer::TK_BUILT_IN_FUNC && tokenizer.get_token_built_in_func() == GDFunctions::RESOURCE_LOAD)) &&
+						tokenizer.get_token(1) == GDTokenizer::TK_PARENTHESIS_OPEN)
+					path_offset = 2;
+				if (path_offset > 0 && tokenizer.get_token(path_offset) == GDTokenizer::TK_CONSTANT &&
+						tokenizer.get_token_constant(path_offset).get_type() == Variant::STRING) {
+					String path = tokenizer.get_token_constant(path_offset);
+					if (path.is_rel_path())
+						path = p_base_dir.plus_file(path);
+					path = path.replace("///", "//").simplify_path();
+					if (path.begins_with("res://") && !found.has(path)) {
+						found.insert(path);
+						r_dependencies.push_back(path);
+					}
+				}
+				tokenizer.advance();
+			}
+		}
+	}
+#endif
+
+	void ScriptParseService::_invalidate_cached(void *p_self, const String &p_path) {
+		ScriptParseService* self = (ScriptParseService*)p_self;
+		self->cache->invalidate(p_path);
+	}
+
 	Dictionary ScriptParseService::resolve(const Dictionary &_data) const {
 		Dictionary data(_data);
 		Request request(data["request"]);
+		request.deadline = ServiceDeadline::from_request(data);
 		Result result = parse_script(request);
 		data["result"] = Dictionary(result);
 		return super::resolve(data);
 	}
 
+	bool ScriptParseService::resolve_stream(const Dictionary &_data, JSONWriter &p_writer) const {
+		// Scripts extending the service post-process the Dictionary result
+		if (get_script_instance())
+			return false;
+		Request request(_data["request"]);
+		request.deadline = ServiceDeadline::from_request(_data);
+		Result result = parse_script(request);
+		p_writer.begin_object();
+		write_fields(p_writer, _data, "result");
+		p_writer.key("result");
+		result.write(p_writer);
+		p_writer.end_object();
+		return true;
+	}
+
+	String ScriptParseService::get_etag(const Dictionary &data) const {
+		if (get_script_instance())
+			return String();
+		// Path only requests take the text from disk or the editor, so the text is the version
+		Request request(data["request"]);
+		if (!request.valid())
+			return String();
+		// Changes of the scripts it extends or loads bump the generation
+		return itos(request.script_text.hash()) + ":" + itos(request.script_text.length()) + ":" + itos(ScriptDependencies::get_generation(request.script_path));
+	}
+
 	bool ScriptParseService::Request::valid() const {
 		return !script_path.empty() && !script_text.empty();
 	}
 
 	ScriptParseService::Request::Request(const Dictionary &request) {
-		String path = request.has("path")? request["path"]:"";
-		path = GlobalConfig::get_singleton()->localize_path(path);
+		_init(request.has("path")? request["path"]:"", request.has("text")? request["text"]:"");
+	}
+
+	ScriptParseService::Request::Request(const JSONObjectView &p_request) {
+		_init(p_request.get_string("path"), p_request.get_string("text"));
+	}
+
+	void ScriptParseService::Request::_init(const String &p_path, const String &p_text) {
+		String path = GlobalConfig::get_singleton()->localize_path(p_path);
 		if(path == "res://" || !path.begins_with("res://"))
 			path = "";
 		script_path = path;
 
-		script_text = request.has("text")? request["text"]:"";
-		if (!script_path.empty() && script_text.empty()) {
-			Ref<Script> script = ResourceLoader::load(script_path);
-			if (!script.is_null() && script.is_valid() && script->cast_to<Script>())
-				script_text = script->get_source_code();
-		}
+		script_text = p_text;
+		if (!script_path.empty() && script_text.empty())
+			script_text = SourceCache::get(script_path);
+	}
+
+	namespace {
+		class ScriptParseCall : public ServiceCall {
+			const ScriptParseService* service;
+			ScriptParseService::Request request;
+		public:
+			virtual bool can_coalesce() const override { return true; }
+			virtual bool is_streamed() const override { return true; }
+			virtual String get_etag() const override {
+				if (!request.valid())
+					return String();
+				return itos(request.script_text.hash()) + ":" + itos(request.script_text.length()) + ":" + itos(ScriptDependencies::get_generation(request.script_path));
+			}
+			virtual void resolve(const JSONObjectView& p_body, JSONWriter& p_writer) override {
+				request.deadline = deadline;
+				ScriptParseService::Result result = service->parse_script(request);
+				p_writer.begin_object();
+				p_body.write_fields(p_writer, "result");
+				p_writer.key("result");
+				result.write(p_writer);
+				p_writer.end_object();
+			}
+			ScriptParseCall(const ScriptParseService* p_service, const JSONObjectView& p_request): service(p_service), request(p_request) {}
+		};
+	}
+
+	ServiceCall* ScriptParseService::decode(const JSONObjectView &p_body) const {
+		JSONObjectView request;
+		p_body.get_object("request", request);
+		return memnew(ScriptParseCall(this, request));
+	}
+
+	ScriptParseService::ScriptParseService() {
+		cache = memnew(ScriptParseCache);
+		ScriptDependencies::add_listener(_invalidate_cached, this);
+	}
+
+	ScriptParseService::~ScriptParseService() {
+		ScriptDependencies::remove_listener(_invalidate_cached, this);
+		cache->save();
+		memdelete(cache);
 	}
 
 	ScriptParseService::Result ScriptParseService::parse_script(const ScriptParseService::Request &request) const {
+		Result result;
+		if(!request.valid())
+			return result;
+		{
+			EDITOR_SERVER_TRACE("parse cache lookup");
+			if(cache->get(request.script_path, request.script_text, result)) {
+				// Results from the cache file are not in the graph of this session yet
+				ScriptDependencies::update(request.script_path, request.script_text.hash(), result.dependencies);
+				return result;
+			}
+		}
+		result = _parse_script(request);
+		if(result.partial)
+			return result;
+		// Dependents of this script get dropped from the cache when its text changed
+		ScriptDependencies::update(request.script_path, request.script_text.hash(), result.dependencies);
+		EDITOR_SERVER_TRACE("parse cache store");
+		cache->put(request.script_path, request.script_text, result);
+		return result;
+	}
+
+	ScriptParseService::Result ScriptParseService::_parse_script(const ScriptParseService::Request &request) const {
 		Result result;
 		if(request.valid()) {
 #ifdef GDSCRIPT_ENABLED
-			GDParser parser;
-			int err = parser.parse(request.script_text, request.script_path.get_base_dir(), true, request.script_path, false);
+			ParseContext* context = _get_parse_context();
+			GDParser& parser = context->parser;
+			ParserReset reset(parser);
+			int err;
+			{
+				EDITOR_SERVER_TRACE("gdscript parse");
+				err = parser.parse(request.script_text, request.script_path.get_base_dir(), true, request.script_path, false);
+			}
 			result.valid = (err == OK);
 			if(!result.valid) {
 				Error e;
@@ -52,13 +224,29 @@ namespace gdexplorer {
 				e.column = parser.get_error_column();
 				result.errors.push_back(e);
 			}
+			{
+				EDITOR_SERVER_TRACE("collect dependencies");
+				_collect_dependencies(request.script_text, request.script_path.get_base_dir(), result.dependencies);
+			}
+			if(request.deadline.expired()) {
+				// Only the syntax errors are known at this point
+				result.valid = false;
+				result.partial = true;
+				return result;
+			}
 
+			// GDScript has no way to drop compiled functions for reuse, so each parse gets its own
 			GDScript script;
 			script.set_source_code(request.script_text);
 			script.set_script_path(request.script_path);
 
-			GDCompiler compiler;
-			if(OK != compiler.compile(&parser, &script)){
+			GDCompiler& compiler = context->compiler;
+			int compile_err;
+			{
+				EDITOR_SERVER_TRACE("gdscript compile");
+				compile_err = compiler.compile(&parser, &script);
+			}
+			if(OK != compile_err){
 				Error e;
 				e.message = compiler.get_error();
 				e.row = compiler.get_error_line();
@@ -66,7 +254,10 @@ namespace gdexplorer {
 				if(-1 == result.errors.find(e))
 					result.errors.push_back(e);
 				result.valid = false;
+			} else if(request.deadline.expired()) {
+				result.partial = true;
 			} else {
+				EDITOR_SERVER_TRACE("collect members");
 				auto _functions = script.get_member_functions();
 				for(auto E = _functions.front(); E; E=E->next()) {
 					Member m;
@@ -122,6 +313,8 @@ namespace gdexplorer {
 	gdexplorer::ScriptParseService::Result::operator Dictionary() const {
 		Dictionary data;
 		data["valid"] = valid;
+		if(partial)
+			data["partial"] = true;
 		data["is_tool"] = is_tool;
 		data["base"] = base_class;
 		data["native"] = native_calss;
@@ -143,8 +336,64 @@ namespace gdexplorer {
 		m["signals"] = export_members(signals);
 		m["constants"] = export_members(constants);
 		data["members"] = m;
+		data["dependencies"] = dependencies;
 
 		return data;
 	}
 
+	void ScriptParseService::Result::write(JSONWriter &p_writer) const {
+		p_writer.begin_object();
+		p_writer.key("valid");
+		p_writer.value(valid);
+		if(partial) {
+			p_writer.key("partial");
+			p_writer.value(true);
+		}
+		p_writer.key("is_tool");
+		p_writer.value(is_tool);
+		p_writer.key("base");
+		p_writer.value(base_class);
+		p_writer.key("native");
+		p_writer.value(native_calss);
+
+		p_writer.key("errors");
+		p_writer.begin_array();
+		for(int i=0; i<errors.size(); ++i ) {
+			p_writer.begin_object();
+			p_writer.key("message");
+			p_writer.value(errors[i].message);
+			p_writer.key("row");
+			p_writer.value(errors[i].row);
+			p_writer.key("column");
+			p_writer.value(errors[i].column);
+			p_writer.end_object();
+		}
+		p_writer.end_array();
+
+		auto export_members = [&p_writer](const char* p_key, const Vector<Member>& mems) {
+			p_writer.key(p_key);
+			p_writer.begin_object();
+			for(int i=0; i<mems.size(); ++i ) {
+				p_writer.key(mems[i].name);
+				p_writer.value(mems[i].line);
+			}
+			p_writer.end_object();
+		};
+		p_writer.key("members");
+		p_writer.begin_object();
+		export_members("variables", members);
+		export_members("functions", functions);
+		export_members("signals", signals);
+		export_members("constants", constants);
+		p_writer.end_object();
+
+		p_writer.key("dependencies");
+		p_writer.begin_array();
+		for(int i=0; i<dependencies.size(); ++i )
+			p_writer.value(dependencies[i]);
+		p_writer.end_array();
+
+		p_writer.end_object();
+	}
+
 }
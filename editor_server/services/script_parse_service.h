@@ -4,10 +4,12 @@
 #include "service.h"
 
 namespace gdexplorer {
+	class ScriptParseCache;
+
 	class ScriptParseService : public EditorServerService {
 		GDCLASS(ScriptParseService,EditorServerService);
 		using super = EditorServerService;
-	protected:
+	public:
 		struct Error {
 			String message;
 			int row = -1;
@@ -38,11 +40,17 @@ namespace gdexplorer {
 			bool valid() const;
 			String script_text;
 			String script_path;
+			ServiceDeadline deadline;
 			Request(const Dictionary& dict);
+			Request(const JSONObjectView& p_request);
+		private:
+			void _init(const String& p_path, const String& p_text);
 		};
 
 		struct Result {
 			bool valid = false;
+			// Ran out of time, errors are the ones found so far
+			bool partial = false;
 			bool is_tool = false;
 			String base_class;
 			String native_calss;
@@ -51,14 +59,27 @@ namespace gdexplorer {
 			Vector<Member> members;
 			Vector<Member> signals;
 			Vector<Member> constants;
+			// res:// paths of what the script extends, preloads and loads
+			Vector<String> dependencies;
 			operator Dictionary() const;
+			void write(JSONWriter& p_writer) const;
 		};
 
 		Result parse_script(const Request& request) const;
+	protected:
+		ScriptParseCache *cache;
+		Result _parse_script(const Request& request) const;
+		static void _invalidate_cached(void* p_self, const String& p_path);
 	public:
 		virtual Dictionary resolve(const Dictionary& _data) const override;
-		ScriptParseService() = default;
-		virtual ~ScriptParseService() = default;
+		virtual bool resolve_stream(const Dictionary& _data, JSONWriter& p_writer) const override;
+		// Whole file parses and compiles must not hold up completion
+		virtual Priority get_priority() const override { return PRIORITY_BULK; }
+		virtual bool can_coalesce(const Dictionary& data) const override { return true; }
+		virtual String get_etag(const Dictionary& data) const override;
+		virtual ServiceCall* decode(const JSONObjectView& p_body) const override;
+		ScriptParseService();
+		virtual ~ScriptParseService();
 	};
 
 }
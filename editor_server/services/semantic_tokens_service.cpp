@@ -0,0 +1,482 @@
+#include "semantic_tokens_service.h"
+#include <core/class_db.h>
+#include <core/globals.h>
+#include <core/io/json.h>
+#include "../json_writer.h"
+#include "../trace.h"
+#include "source_cache.h"
+#ifdef GDSCRIPT_ENABLED
+#include "modules/gdscript/gd_parser.h"
+#endif
+
+namespace gdexplorer {
+
+	static const char* _token_types[SemanticTokensService::TOKEN_TYPE_MAX] = {
+		"class",
+		"property",
+		"method",
+		"event",
+		"enumMember",
+		"parameter",
+		"variable",
+	};
+
+	static inline bool _is_identifier_start(CharType c) {
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	static inline bool _is_identifier_char(CharType c) {
+		return _is_identifier_start(c) || (c >= '0' && c <= '9');
+	}
+
+	static inline String _strip_cr(const String& p_line) {
+		return p_line.ends_with("\r") ? p_line.substr(0, p_line.length() - 1) : p_line;
+	}
+
+	static inline bool _is_declaring_keyword(const String& p_word) {
+		return p_word == "var" || p_word == "const" || p_word == "func" || p_word == "signal" || p_word == "class" || p_word == "for";
+	}
+
+	SemanticTokensService::Request::Request(const Dictionary &request) {
+		String path = request.has("path")? request["path"]:"";
+		path = GlobalConfig::get_singleton()->localize_path(path);
+		if(path == "res://" || !path.begins_with("res://"))
+			path = "";
+		script_path = path;
+		script_text = request.has("text")? request["text"]:"";
+		if (!script_path.empty() && script_text.empty())
+			script_text = SourceCache::get(script_path);
+		previous_result_id = request.has("previous_result_id")? request["previous_result_id"]:"";
+	}
+
+	bool SemanticTokensService::Request::valid() const {
+		return !script_path.empty() && !script_text.empty();
+	}
+
+	SemanticTokensService::SemanticTokensService() {
+		mutex = Mutex::create();
+		MemoryBudget::add("semantic_tokens", this);
+	}
+
+	SemanticTokensService::~SemanticTokensService() {
+		MemoryBudget::remove(this);
+		memdelete(mutex);
+	}
+
+	void SemanticTokensService::_scan_line(Line &r_line) {
+		const String& text = r_line.text;
+		const int len = text.length();
+		bool in_string = r_line.string_in;
+		bool declare = false;
+		bool after_dot = false;
+		bool after_self = false;
+		r_line.words.clear();
+
+		int i = 0;
+		while (i < len) {
+			CharType c = text[i];
+			if (in_string) {
+				if (c == '\\')
+					i += 2;
+				else if (c == '"' && i + 2 < len && text[i+1] == '"' && text[i+2] == '"') {
+					in_string = false;
+					i += 3;
+				} else
+					i++;
+				continue;
+			}
+			if (c == '#')
+				break;
+			if (c == '"' || c == '\'') {
+				if (c == '"' && i + 2 < len && text[i+1] == '"' && text[i+2] == '"') {
+					in_string = true;
+					i += 3;
+					continue;
+				}
+				i++;
+				while (i < len && text[i] != c)
+					i += text[i] == '\\' ? 2 : 1;
+				i++;
+				declare = after_dot = after_self = false;
+				continue;
+			}
+			if (_is_identifier_start(c)) {
+				int from = i;
+				while (i < len && _is_identifier_char(text[i]))
+					i++;
+				String name = text.substr(from, i - from);
+				if (_is_declaring_keyword(name)) {
+					declare = true;
+					after_dot = after_self = false;
+					continue;
+				}
+				Word w;
+				w.column = from;
+				w.name = name;
+				w.declaration = declare;
+				w.indexed = after_dot;
+				r_line.words.push_back(w);
+				after_self = !after_dot && name == "self";
+				declare = after_dot = false;
+				continue;
+			}
+			if (c >= '0' && c <= '9') {
+				while (i < len && (_is_identifier_char(text[i]) || text[i] == '.'))
+					i++;
+				declare = after_dot = after_self = false;
+				continue;
+			}
+			if (c == '.') {
+				// Members of self are the script's own, others belong to unknown objects
+				after_dot = !after_self;
+				after_self = false;
+			} else if (c != ' ' && c != '\t') {
+				declare = after_dot = after_self = false;
+			}
+			i++;
+		}
+		r_line.string_out = in_string;
+	}
+
+	void SemanticTokensService::_update_lines(const Vector<Line> &p_old, const String &p_text, Vector<Line> &r_lines) {
+		Vector<String> texts = p_text.split("\n");
+		const int count = texts.size();
+		const int old_count = p_old.size();
+		int head = 0;
+		while (head < count && head < old_count && p_old[head].text == _strip_cr(texts[head]))
+			head++;
+		int tail = 0;
+		while (tail < count - head && tail < old_count - head && p_old[old_count-1-tail].text == _strip_cr(texts[count-1-tail]))
+			tail++;
+
+		r_lines.clear();
+		bool in_string = false;
+		for (int i = 0; i < count; i++) {
+			if (i < head) {
+				r_lines.push_back(p_old[i]);
+			} else {
+				// Unchanged tail lines are reused unless an edit opened or closed a multi-line string above them
+				const Line* old = i >= count - tail ? &p_old[old_count - count + i] : nullptr;
+				if (old && old->string_in == in_string) {
+					r_lines.push_back(*old);
+				} else {
+					Line line;
+					line.text = _strip_cr(texts[i]);
+					line.string_in = in_string;
+					_scan_line(line);
+					r_lines.push_back(line);
+				}
+			}
+			in_string = r_lines[i].string_out;
+		}
+	}
+
+#ifdef GDSCRIPT_ENABLED
+	static void _collect_block(const GDParser::BlockNode* p_block, SemanticTokensService::Scope& r_scope) {
+		if (!p_block)
+			return;
+		for (int i = 0; i < p_block->variables.size(); i++)
+			r_scope.locals.insert(p_block->variables[i]);
+		for (const List<GDParser::Node*>::Element *E = p_block->statements.front(); E; E = E->next()) {
+			if (E->get()->type != GDParser::Node::TYPE_CONTROL_FLOW)
+				continue;
+			const GDParser::ControlFlowNode* cf = static_cast<const GDParser::ControlFlowNode*>(E->get());
+			if (cf->cf_type == GDParser::ControlFlowNode::CF_FOR && cf->arguments.size() && cf->arguments[0]->type == GDParser::Node::TYPE_IDENTIFIER)
+				r_scope.locals.insert(static_cast<const GDParser::IdentifierNode*>(cf->arguments[0])->name);
+			_collect_block(cf->body, r_scope);
+			_collect_block(cf->body_else, r_scope);
+		}
+	}
+
+	static void _collect_function(const GDParser::FunctionNode* p_function, SemanticTokensService::Symbols& r_symbols) {
+		r_symbols.methods.insert(p_function->name);
+		SemanticTokensService::Scope scope;
+		scope.from_line = p_function->line - 1;
+		scope.to_line = scope.from_line;
+		for (int i = 0; i < p_function->arguments.size(); i++)
+			scope.parameters.insert(p_function->arguments[i]);
+		_collect_block(p_function->body, scope);
+		r_symbols.scopes.push_back(scope);
+	}
+
+	static void _collect_class(const GDParser::ClassNode* p_class, SemanticTokensService::Symbols& r_symbols) {
+		if (p_class->name != StringName())
+			r_symbols.classes.insert(p_class->name);
+		for (int i = 0; i < p_class->variables.size(); i++)
+			r_symbols.members.insert(p_class->variables[i].identifier);
+		for (int i = 0; i < p_class->constant_expressions.size(); i++)
+			r_symbols.constants.insert(p_class->constant_expressions[i].identifier);
+		for (int i = 0; i < p_class->_signals.size(); i++)
+			r_symbols.signals.insert(p_class->_signals[i].name);
+		for (int i = 0; i < p_class->functions.size(); i++)
+			_collect_function(p_class->functions[i], r_symbols);
+		for (int i = 0; i < p_class->static_functions.size(); i++)
+			_collect_function(p_class->static_functions[i], r_symbols);
+		for (int i = 0; i < p_class->subclasses.size(); i++)
+			_collect_class(p_class->subclasses[i], r_symbols);
+	}
+#endif
+
+	bool SemanticTokensService::_collect_symbols(const Request &p_request, Symbols &r_symbols) {
+#ifdef GDSCRIPT_ENABLED
+		GDParser parser;
+		if (parser.parse(p_request.script_text, p_request.script_path.get_base_dir(), true, p_request.script_path, false) != OK)
+			return false;
+		const GDParser::Node* root = parser.get_parse_tree();
+		if (!root || root->type != GDParser::Node::TYPE_CLASS)
+			return false;
+		_collect_class(static_cast<const GDParser::ClassNode*>(root), r_symbols);
+
+		// A function reaches to the line before the next one
+		r_symbols.scopes.sort();
+		for (int i = 0; i < r_symbols.scopes.size(); i++)
+			r_symbols.scopes[i].to_line = i + 1 < r_symbols.scopes.size() ? r_symbols.scopes[i+1].from_line - 1 : 0x7FFFFFFF;
+		r_symbols.valid = true;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	int SemanticTokensService::_classify(const Symbols &p_symbols, const Word &p_word, int p_line) {
+		if (p_word.indexed)
+			return -1;
+		const String& name = p_word.name;
+
+		int low = 0, high = p_symbols.scopes.size() - 1;
+		while (low <= high) {
+			int mid = (low + high) / 2;
+			const Scope& scope = p_symbols.scopes[mid];
+			if (p_line < scope.from_line) {
+				high = mid - 1;
+			} else if (p_line > scope.to_line) {
+				low = mid + 1;
+			} else {
+				if (scope.parameters.has(name))
+					return TOKEN_PARAMETER;
+				if (scope.locals.has(name))
+					return TOKEN_LOCAL;
+				break;
+			}
+		}
+		if (p_symbols.members.has(name))
+			return TOKEN_MEMBER;
+		if (p_symbols.constants.has(name))
+			return TOKEN_CONSTANT;
+		if (p_symbols.signals.has(name))
+			return TOKEN_SIGNAL;
+		if (p_symbols.methods.has(name))
+			return TOKEN_METHOD;
+		if (p_symbols.classes.has(name) || ClassDB::class_exists(name))
+			return TOKEN_CLASS;
+		return -1;
+	}
+
+	void SemanticTokensService::_encode(const Vector<Line> &p_lines, const Symbols &p_symbols, Vector<int> &r_data) {
+		int prev_line = 0;
+		int prev_column = 0;
+		for (int l = 0; l < p_lines.size(); l++) {
+			const Vector<Word>& words = p_lines[l].words;
+			for (int i = 0; i < words.size(); i++) {
+				int type = _classify(p_symbols, words[i], l);
+				if (type < 0)
+					continue;
+				r_data.push_back(l - prev_line);
+				r_data.push_back(l == prev_line ? words[i].column - prev_column : words[i].column);
+				r_data.push_back(words[i].name.length());
+				r_data.push_back(type);
+				r_data.push_back(words[i].declaration ? MODIFIER_DECLARATION : 0);
+				prev_line = l;
+				prev_column = words[i].column;
+			}
+		}
+	}
+
+	static void _write_ints(JSONWriter& p_writer, const int* p_data, int p_count) {
+		p_writer.begin_array();
+		for (int i = 0; i < p_count; i++)
+			p_writer.value(p_data[i]);
+		p_writer.end_array();
+	}
+
+	static int64_t _size_of_names(const Set<String>& p_names) {
+		int64_t bytes = 0;
+		for (const Set<String>::Element *E = p_names.front(); E; E = E->next())
+			bytes += MemoryBudget::size_of(E->get());
+		return bytes;
+	}
+
+	int64_t SemanticTokensService::_size_of(const String &p_path, const Document &p_document) {
+		int64_t bytes = sizeof(Document) + MemoryBudget::size_of(p_path) + p_document.data.size() * sizeof(int);
+		for (int i = 0; i < p_document.lines.size(); i++) {
+			const Line& line = p_document.lines[i];
+			bytes += sizeof(Line) + MemoryBudget::size_of(line.text);
+			for (int j = 0; j < line.words.size(); j++)
+				bytes += sizeof(Word) + MemoryBudget::size_of(line.words[j].name);
+		}
+		const Symbols& symbols = p_document.symbols;
+		bytes += _size_of_names(symbols.classes) + _size_of_names(symbols.members) + _size_of_names(symbols.methods);
+		bytes += _size_of_names(symbols.signals) + _size_of_names(symbols.constants);
+		for (int i = 0; i < symbols.scopes.size(); i++)
+			bytes += sizeof(Scope) + _size_of_names(symbols.scopes[i].parameters) + _size_of_names(symbols.scopes[i].locals);
+		return bytes;
+	}
+
+	void SemanticTokensService::_erase(Map<String, Document>::Element *p_document) const {
+		memory -= p_document->get().bytes;
+		lru.erase(p_document->get().lru);
+		documents.erase(p_document);
+	}
+
+	int64_t SemanticTokensService::get_memory_usage() const {
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	uint64_t SemanticTokensService::get_oldest_use() const {
+		mutex->lock();
+		uint64_t oldest = lru.front() ? documents[lru.front()->get()].last_used : 0;
+		mutex->unlock();
+		return oldest;
+	}
+
+	int64_t SemanticTokensService::evict_oldest() {
+		int64_t freed = 0;
+		mutex->lock();
+		Map<String, Document>::Element *E = lru.front() ? documents.find(lru.front()->get()) : nullptr;
+		if (E) {
+			freed = E->get().bytes;
+			_erase(E);
+		}
+		mutex->unlock();
+		return freed;
+	}
+
+	void SemanticTokensService::_write_result(JSONWriter &p_writer, const Request &p_request) const {
+		p_writer.begin_object();
+		p_writer.key("valid");
+		p_writer.value(p_request.valid());
+		if (!p_request.valid()) {
+			p_writer.end_object();
+			return;
+		}
+
+		Document old;
+		mutex->lock();
+		const Map<String, Document>::Element *E = documents.find(p_request.script_path);
+		if (E)
+			old = E->get();
+		mutex->unlock();
+
+		Document doc;
+		{
+			EDITOR_SERVER_TRACE("scan lines");
+			_update_lines(old.lines, p_request.script_text, doc.lines);
+		}
+		{
+			EDITOR_SERVER_TRACE("collect symbols");
+			// While the script does not parse, the last symbols that did keep the highlighting stable
+			if (!_collect_symbols(p_request, doc.symbols))
+				doc.symbols = old.symbols;
+		}
+		{
+			EDITOR_SERVER_TRACE("encode tokens");
+			_encode(doc.lines, doc.symbols, doc.data);
+		}
+
+		doc.bytes = _size_of(p_request.script_path, doc);
+		mutex->lock();
+		doc.result_id = itos(++next_result_id);
+		doc.last_used = MemoryBudget::tick();
+		Map<String, Document>::Element *D = documents.find(p_request.script_path);
+		if (D)
+			_erase(D);
+		doc.lru = lru.push_back(p_request.script_path);
+		documents[p_request.script_path] = doc;
+		memory += doc.bytes;
+		if (documents.size() > MAX_DOCUMENTS)
+			_erase(documents.find(lru.front()->get()));
+		mutex->unlock();
+		MemoryBudget::enforce();
+
+		p_writer.key("result_id");
+		p_writer.value(doc.result_id);
+		const Vector<int>& new_data = doc.data;
+		const int* data = new_data.ptr();
+		if (!p_request.previous_result_id.empty() && p_request.previous_result_id == old.result_id) {
+			// A single edit replacing everything between the unchanged head and tail of the array
+			const Vector<int>& prev_data = old.data;
+			const int* old_data = prev_data.ptr();
+			int size = doc.data.size(), old_size = old.data.size();
+			int head = 0;
+			while (head < size && head < old_size && data[head] == old_data[head])
+				head++;
+			int tail = 0;
+			while (tail < size - head && tail < old_size - head && data[size-1-tail] == old_data[old_size-1-tail])
+				tail++;
+			p_writer.key("edits");
+			p_writer.begin_array();
+			if (head + tail != size || head + tail != old_size) {
+				p_writer.begin_object();
+				p_writer.key("start");
+				p_writer.value(head);
+				p_writer.key("deleteCount");
+				p_writer.value(old_size - head - tail);
+				p_writer.key("data");
+				_write_ints(p_writer, data + head, size - head - tail);
+				p_writer.end_object();
+			}
+			p_writer.end_array();
+		} else {
+			p_writer.key("legend");
+			p_writer.begin_object();
+			p_writer.key("tokenTypes");
+			p_writer.begin_array();
+			for (int i = 0; i < TOKEN_TYPE_MAX; i++)
+				p_writer.value(_token_types[i]);
+			p_writer.end_array();
+			p_writer.key("tokenModifiers");
+			p_writer.begin_array();
+			p_writer.value("declaration");
+			p_writer.end_array();
+			p_writer.end_object();
+			p_writer.key("data");
+			_write_ints(p_writer, data, doc.data.size());
+		}
+		p_writer.end_object();
+	}
+
+	bool SemanticTokensService::resolve_stream(const Dictionary &_data, JSONWriter &p_writer) const {
+		if (get_script_instance())
+			return false;
+		Request request(_data["request"]);
+		p_writer.begin_object();
+		write_fields(p_writer, _data, "result");
+		p_writer.key("result");
+		_write_result(p_writer, request);
+		p_writer.end_object();
+		return true;
+	}
+
+	Dictionary SemanticTokensService::resolve(const Dictionary &_data) const {
+		Dictionary data(_data);
+		Request request(data["request"]);
+
+		JSONBufferSink sink;
+		{
+			JSONWriter writer(&sink);
+			_write_result(writer, request);
+		}
+		Variant result;
+		String errmsg;
+		int errline = -1;
+		String json;
+		json.parse_utf8((const char*)sink.ptr(), sink.size());
+		if (JSON::parse(json, result, errmsg, errline) == OK)
+			data["result"] = result;
+		return super::resolve(data);
+	}
+
+}
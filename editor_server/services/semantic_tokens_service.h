@@ -0,0 +1,121 @@
+#ifndef GD_EXPLORER_SEMANTIC_TOKENS_SERVICE_H
+#define GD_EXPLORER_SEMANTIC_TOKENS_SERVICE_H
+
+#include "service.h"
+#include <core/os/mutex.h>
+#include "../memory_budget.h"
+
+namespace gdexplorer {
+
+	// Classifies the identifiers of a script for highlighting, encoded like LSP semantic tokens
+	class SemanticTokensService : public EditorServerService, public MemoryBudget::Consumer {
+		GDCLASS(SemanticTokensService, EditorServerService);
+		using super = EditorServerService;
+	public:
+		enum TokenType {
+			TOKEN_CLASS,
+			TOKEN_MEMBER,
+			TOKEN_METHOD,
+			TOKEN_SIGNAL,
+			TOKEN_CONSTANT,
+			TOKEN_PARAMETER,
+			TOKEN_LOCAL,
+			TOKEN_TYPE_MAX
+		};
+
+		enum TokenModifier {
+			MODIFIER_DECLARATION = 1,
+		};
+
+		enum {
+			// Documents kept for delta requests, the least recently used goes first
+			MAX_DOCUMENTS = 32,
+		};
+
+		struct Request {
+			String script_path;
+			String script_text;
+			String previous_result_id;
+			bool valid() const;
+			Request(const Dictionary& dict);
+		};
+
+		// Identifier found by scanning a single line
+		struct Word {
+			int column;
+			String name;
+			// Follows var, const, func, signal, class or for
+			bool declaration;
+			// Follows a dot, only members of self are known
+			bool indexed;
+		};
+
+		struct Line {
+			String text;
+			// Inside a triple quoted string at the start and at the end of the line
+			bool string_in = false;
+			bool string_out = false;
+			Vector<Word> words;
+		};
+
+		// Lines of a function, zero based
+		struct Scope {
+			int from_line;
+			int to_line;
+			Set<String> parameters;
+			Set<String> locals;
+			bool operator<(const Scope& p_scope) const { return from_line < p_scope.from_line; }
+		};
+
+		struct Symbols {
+			bool valid = false;
+			Set<String> classes;
+			Set<String> members;
+			Set<String> methods;
+			Set<String> signals;
+			Set<String> constants;
+			Vector<Scope> scopes;
+		};
+
+		struct Document {
+			String result_id;
+			Vector<Line> lines;
+			Symbols symbols;
+			Vector<int> data;
+			uint64_t last_used = 0;
+			int64_t bytes = 0;
+			List<String>::Element* lru = nullptr;
+		};
+
+	protected:
+		mutable Map<String, Document> documents;
+		// Paths from least to most recently used
+		mutable List<String> lru;
+		mutable int64_t memory = 0;
+		mutable int next_result_id = 0;
+		Mutex *mutex;
+
+		static void _scan_line(Line& r_line);
+		// Rescans only the lines between the unchanged head and tail of the text
+		static void _update_lines(const Vector<Line>& p_old, const String& p_text, Vector<Line>& r_lines);
+		static bool _collect_symbols(const Request& p_request, Symbols& r_symbols);
+		static int _classify(const Symbols& p_symbols, const Word& p_word, int p_line);
+		static void _encode(const Vector<Line>& p_lines, const Symbols& p_symbols, Vector<int>& r_data);
+		static int64_t _size_of(const String& p_path, const Document& p_document);
+		void _erase(Map<String, Document>::Element* p_document) const;
+		void _write_result(JSONWriter& p_writer, const Request& p_request) const;
+	public:
+		virtual Dictionary resolve(const Dictionary& _data) const override;
+		virtual bool resolve_stream(const Dictionary& _data, JSONWriter& p_writer) const override;
+
+		// An evicted document is scanned from scratch on its next request
+		virtual int64_t get_memory_usage() const override;
+		virtual uint64_t get_oldest_use() const override;
+		virtual int64_t evict_oldest() override;
+		SemanticTokensService();
+		virtual ~SemanticTokensService();
+	};
+
+}
+
+#endif // GD_EXPLORER_SEMANTIC_TOKENS_SERVICE_H
@@ -1,19 +1,211 @@
 #include "service.h"
 #include "script_language.h"
+#include "../json_writer.h"
+#include <core/os/os.h>
+#include <core/os/dir_access.h>
 namespace gdexplorer {
 
+	bool ServiceDeadline::expired() const {
+		return usec && OS::get_singleton()->get_ticks_usec() >= usec;
+	}
+
+	ServiceDeadline ServiceDeadline::from_request(const Dictionary &data) {
+		ServiceDeadline deadline;
+		if (data.has("deadline_usec"))
+			deadline.usec = uint64_t(double(data["deadline_usec"]));
+		return deadline;
+	}
+
+	void ServiceDeadline::stamp(Dictionary &data, int p_timeout_msec) {
+		if (p_timeout_msec <= 0) {
+			// Only the server sets it, a client can not pick its own
+			data.erase("deadline_usec");
+			return;
+		}
+		// Stored as a real, an int Variant is too small for tick counts
+		data["deadline_usec"] = double(OS::get_singleton()->get_ticks_usec() + uint64_t(p_timeout_msec) * 1000);
+	}
+
+	ServiceDeadline ServiceDeadline::after(int p_timeout_msec) {
+		ServiceDeadline deadline;
+		if (p_timeout_msec > 0)
+			deadline.usec = OS::get_singleton()->get_ticks_usec() + uint64_t(p_timeout_msec) * 1000;
+		return deadline;
+	}
+
+
+	ServiceCompletion::ServiceCompletion() {
+	}
+
+	ServiceCompletion::~ServiceCompletion() {
+	}
+
+	void ServiceCompletion::_bind_methods() {
+		ClassDB::bind_method(_MD("get_request"), &ServiceCompletion::get_request);
+		ClassDB::bind_method(_MD("complete", "result:Dictionary"), &ServiceCompletion::complete);
+		ClassDB::bind_method(_MD("is_completed"), &ServiceCompletion::is_completed);
+	}
+
+	void ServiceCompletion::complete(const Dictionary &p_result) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (completed)
+				return;
+			result = p_result;
+			completed = true;
+		}
+		done.notify_all();
+	}
+
+	bool ServiceCompletion::is_completed() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return completed;
+	}
+
+	Dictionary ServiceCompletion::get_result() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return result;
+	}
+
+	bool ServiceCompletion::wait(const ServiceDeadline &p_deadline) {
+		ServiceDeadline deadline = p_deadline.is_set() ? p_deadline : ServiceDeadline::after(DEFAULT_TIMEOUT_MSEC);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!completed) {
+			uint64_t now = OS::get_singleton()->get_ticks_usec();
+			if (now >= deadline.usec)
+				return false;
+			// Woken by complete(), the loop covers spurious wakeups
+			done.wait_for(lock, std::chrono::microseconds(deadline.usec - now));
+		}
+		return true;
+	}
+
+	EditorServerService::EditorServerService() {
+		dispatch_mutex = Mutex::create();
+		resolve_method = "resolve";
+		resolve_async_method = "resolve_async";
+		// Setting or reloading a script replaces the instance the cached lookups belong to
+		connect("script_changed", this, "_script_changed");
+	}
+
+	EditorServerService::~EditorServerService() {
+		memdelete(dispatch_mutex);
+	}
+
+	EditorServerService::ScriptDispatch EditorServerService::_get_dispatch() const {
+		ScriptInstance* instance = get_script_instance();
+		if (!instance)
+			return ScriptDispatch();
+		dispatch_mutex->lock();
+		if (dispatch.instance != instance || dispatch.generation != generation) {
+			dispatch.instance = instance;
+			dispatch.generation = generation;
+			dispatch.has_resolve = instance->has_method(resolve_method);
+			dispatch.has_resolve_async = instance->has_method(resolve_async_method);
+		}
+		ScriptDispatch d = dispatch;
+		dispatch_mutex->unlock();
+		return d;
+	}
+
+	void EditorServerService::_invalidate_dispatch(uint32_t p_generation) const {
+		dispatch_mutex->lock();
+		if (generation == p_generation)
+			generation++;
+		dispatch_mutex->unlock();
+	}
+
+	void EditorServerService::_script_changed() {
+		dispatch_mutex->lock();
+		generation++;
+		dispatch_mutex->unlock();
+	}
 
 	void EditorServerService::_bind_methods() {
+		ClassDB::bind_method(_MD("_script_changed"), &EditorServerService::_script_changed);
 		ClassDB::add_virtual_method(get_class_static(), MethodInfo(Variant::DICTIONARY,"resolve",PropertyInfo(Variant::DICTIONARY,"request")));
+		ClassDB::add_virtual_method(get_class_static(), MethodInfo("resolve_async",PropertyInfo(Variant::DICTIONARY,"request"),PropertyInfo(Variant::OBJECT,"completion")));
+		BIND_CONSTANT(PRIORITY_INTERACTIVE);
+		BIND_CONSTANT(PRIORITY_NORMAL);
+		BIND_CONSTANT(PRIORITY_BULK);
 	}
 
 	Dictionary EditorServerService::resolve(const Dictionary &data) const {
-		if (get_script_instance() && get_script_instance()->has_method("resolve")) {
-			return get_script_instance()->call("resolve", data);
-		}
-		else {
+		ScriptDispatch d = _get_dispatch();
+		if (!d.has_resolve)
 			return data;
+		// Dictionaries are copied on write, the script gets the request without a deep copy
+		Variant request = data;
+		const Variant* args[1] = { &request };
+		Variant::CallError ce;
+		Variant result = d.instance->call(resolve_method, args, 1, ce);
+		// Reloading a script can take methods away without a script_changed signal
+		if (ce.error == Variant::CallError::CALL_ERROR_INVALID_METHOD)
+			_invalidate_dispatch(d.generation);
+		return result;
+	}
+
+	bool EditorServerService::resolve_async(const Dictionary &data, const Ref<ServiceCompletion> &p_completion) const {
+		ScriptDispatch d = _get_dispatch();
+		if (!d.has_resolve_async)
+			return false;
+		Variant request = data;
+		Variant completion = p_completion;
+		const Variant* args[2] = { &request, &completion };
+		Variant::CallError ce;
+		d.instance->call(resolve_async_method, args, 2, ce);
+		if (ce.error == Variant::CallError::CALL_ERROR_INVALID_METHOD)
+			_invalidate_dispatch(d.generation);
+		if (ce.error != Variant::CallError::CALL_OK) {
+			// The script has the method but the call failed, nothing will ever complete the request
+			Dictionary failed = data;
+			failed["error"] = "resolve_async failed";
+			p_completion->complete(failed);
+		}
+		return true;
+	}
+
+	bool EditorServerService::can_resolve_async(const Dictionary &data) const {
+		return _get_dispatch().has_resolve_async;
+	}
+
+	bool EditorServerService::resolve_stream(const Dictionary &data, JSONWriter &p_writer) const {
+		return false;
+	}
+
+	void EditorServerService::write_fields(JSONWriter &p_writer, const Dictionary &data, const char *p_skip) {
+		List<Variant> keys;
+		data.get_key_list(&keys);
+		for (List<Variant>::Element *E = keys.front(); E; E = E->next()) {
+			String key = E->get();
+			if ((p_skip && key == p_skip) || is_internal_field(key))
+				continue;
+			p_writer.key(key);
+			p_writer.value(data[E->get()]);
+		}
+	}
+
+	bool EditorServerService::is_internal_field(const String &p_key) {
+		return p_key == "deadline_usec" || p_key == "headers";
+	}
+
+	void EditorServerService::strip_internal_fields(Dictionary &data) {
+		data.erase("deadline_usec");
+		data.erase("headers");
+	}
+
+	Error EditorServerService::replace_file(const String &p_from, const String &p_to) {
+		DirAccess* dir = DirAccess::create_for_path(p_to);
+		if (!dir)
+			return ERR_CANT_CREATE;
+		Error err = dir->rename(p_from, p_to);
+		if (err != OK && dir->file_exists(p_to)) {
+			// Some platforms refuse to rename over an existing file
+			dir->remove(p_to);
+			err = dir->rename(p_from, p_to);
 		}
+		memdelete(dir);
+		return err;
 	}
 
 }
@@ -3,18 +3,146 @@
 
 #include <core/reference.h>
 #include <core/dictionary.h>
+#include <core/list.h>
+#include <core/os/mutex.h>
+#include <mutex>
+#include <condition_variable>
 
 namespace gdexplorer {
 
+	class JSONWriter;
+	class JSONObjectView;
+	class ServiceCall;
+
+	// Time by which a request should be answered, services check it between units of work
+	struct ServiceDeadline {
+		// Ticks in usec, 0 means no limit
+		uint64_t usec = 0;
+
+		bool is_set() const { return usec != 0; }
+		bool expired() const;
+		// Reads the deadline the server stamped into the request data
+		static ServiceDeadline from_request(const Dictionary& data);
+		static void stamp(Dictionary& data, int p_timeout_msec);
+		// Deadline p_timeout_msec from now, none when it is not positive
+		static ServiceDeadline after(int p_timeout_msec);
+	};
+
+	// Handle of a request resolved asynchronously, the service calls complete() from any thread when it is done
+	class ServiceCompletion : public Reference {
+		GDCLASS(ServiceCompletion, Reference);
+		Dictionary request;
+		Dictionary result;
+		// Standard primitives for the timed wait, Godot's Semaphore has none
+		mutable std::mutex mutex;
+		std::condition_variable done;
+		bool completed = false;
+	protected:
+		static void _bind_methods();
+	public:
+		enum {
+			// Waits without a deadline end here, a script that never completes must not hold its connection for good
+			DEFAULT_TIMEOUT_MSEC = 60000,
+		};
+
+		Dictionary get_request() const { return request; }
+		void set_request(const Dictionary& p_request) { request = p_request; }
+		// Only the first result counts, later calls are ignored
+		void complete(const Dictionary& p_result);
+		bool is_completed() const;
+		Dictionary get_result() const;
+		// Parks the calling thread until complete() or the deadline, DEFAULT_TIMEOUT_MSEC when none is set.
+		// Returns whether the result arrived
+		bool wait(const ServiceDeadline& p_deadline);
+		ServiceCompletion();
+		~ServiceCompletion();
+	};
+
 	class EditorServerService : public Reference {
 		GDCLASS(EditorServerService, Reference);
+
+		// Whether the attached script implements the entry points, looked up once per script.
+		// The call still finds the method by name, only has_method() and the StringName conversions are saved
+		struct ScriptDispatch {
+			ScriptInstance* instance = nullptr;
+			// Instances can be freed and another one allocated at the same address, the generation tells them apart
+			uint32_t generation = 0;
+			bool has_resolve = false;
+			bool has_resolve_async = false;
+		};
+		mutable ScriptDispatch dispatch;
+		// Bumped whenever the script is set, replaced or found to have changed its methods
+		mutable uint32_t generation = 1;
+		Mutex *dispatch_mutex;
+		StringName resolve_method;
+		StringName resolve_async_method;
+
+		ScriptDispatch _get_dispatch() const;
+		// Forgets the lookups of the given generation, after a call found the method missing
+		void _invalidate_dispatch(uint32_t p_generation) const;
+		void _script_changed();
+	public:
+		// Scheduling class of the requests a service resolves
+		enum Priority {
+			PRIORITY_INTERACTIVE,
+			PRIORITY_NORMAL,
+			PRIORITY_BULK,
+			PRIORITY_MAX
+		};
 	protected:
 		static void _bind_methods();
 	public:
-		EditorServerService() = default;
-		virtual ~EditorServerService() = default;
+		EditorServerService();
+		virtual ~EditorServerService();
 //		EditorServerService& operator=(EditorServerService&) = default;
 		virtual Dictionary resolve(const Dictionary& data) const;
+		// Writes the whole response for data into p_writer as it is produced.
+		// Returns false without writing anything when the service only supports resolve()
+		virtual bool resolve_stream(const Dictionary& data, JSONWriter& p_writer) const;
+		// Starts resolving data and returns at once, the result goes to p_completion later.
+		// Returns false when the service has no asynchronous variant
+		virtual bool resolve_async(const Dictionary& data, const Ref<ServiceCompletion>& p_completion) const;
+		// Whether resolve_async() may take data, checked before a completion is allocated for it
+		virtual bool can_resolve_async(const Dictionary& data) const;
+		// Writes every field of data but p_skip and the internal ones into the object currently open in p_writer
+		static void write_fields(JSONWriter& p_writer, const Dictionary& data, const char* p_skip = nullptr);
+		// Fields the server adds to the request data for the service, never echoed to the client
+		static bool is_internal_field(const String& p_key);
+		static void strip_internal_fields(Dictionary& data);
+		// Moves p_from over p_to so readers never see a half written file
+		static Error replace_file(const String& p_from, const String& p_to);
+		// Extra request header fields the service wants under data["headers"]
+		virtual void get_request_headers(List<String>* r_headers) const {}
+		// Priority the service gets when it is registered without one
+		virtual Priority get_priority() const { return PRIORITY_NORMAL; }
+		// Lets a service move single requests to another class than the registered one
+		virtual Priority get_request_priority(const Dictionary& data, Priority p_registered) const { return p_registered; }
+		// Requests that wait on other requests to this server run on their connection thread, holding a worker could starve those
+		virtual bool runs_on_connection(const Dictionary& data) const { return false; }
+		// Identical requests arriving together may share one resolution and its encoded response
+		virtual bool can_coalesce(const Dictionary& data) const { return false; }
+		// Version of what a result depends on besides the request body, served as part of an ETag.
+		// Empty when results can not be validated that way
+		virtual String get_etag(const Dictionary& data) const { return String(); }
+		// Typed fast path: reads the request straight from the body text, skipping the Dictionary round trip.
+		// Returns nullptr when the service, its script or the request only work with resolve()
+		virtual ServiceCall* decode(const JSONObjectView& p_body) const { return nullptr; }
+	};
+
+	// One decoded request of the typed path, owned by the server and deleted once answered
+	class ServiceCall {
+	public:
+		ServiceDeadline deadline;
+		// Same meaning as the Dictionary based counterparts of EditorServerService
+		virtual EditorServerService::Priority get_priority(EditorServerService::Priority p_registered) const { return p_registered; }
+		virtual bool can_coalesce() const { return false; }
+		virtual String get_etag() const { return String(); }
+		// Written to the connection as it is produced, like resolve_stream() of the service.
+		// Other calls are encoded first and sent with a Content-Length
+		virtual bool is_streamed() const { return false; }
+		// Writes the whole response object, p_body is the request it was decoded from
+		virtual void resolve(const JSONObjectView& p_body, JSONWriter& p_writer) = 0;
+		virtual ~ServiceCall() {}
 	};
 
 }
@@ -0,0 +1,178 @@
+#include "source_cache.h"
+#include <core/os/os.h>
+#include <core/os/file_access.h>
+#include <core/resource.h>
+#include <core/script_language.h>
+#include "script_dependencies.h"
+#include "../memory_budget.h"
+
+namespace gdexplorer {
+
+	Mutex *SourceCache::mutex = nullptr;
+	Map<String, SourceCache::Entry> SourceCache::entries;
+	List<String> SourceCache::lru;
+	int64_t SourceCache::memory = 0;
+
+	namespace {
+		class SourceCacheMemory : public MemoryBudget::Consumer {
+		public:
+			virtual int64_t get_memory_usage() const override { return SourceCache::get_memory_usage(); }
+			virtual uint64_t get_oldest_use() const override { return SourceCache::get_oldest_use(); }
+			virtual int64_t evict_oldest() override { return SourceCache::evict_oldest(); }
+		};
+		SourceCacheMemory _memory_consumer;
+	}
+
+	void SourceCache::initialize() {
+		if (!mutex) {
+			mutex = Mutex::create();
+			MemoryBudget::add("source_cache", &_memory_consumer);
+		}
+	}
+
+	void SourceCache::finalize() {
+		if (mutex) {
+			MemoryBudget::remove(&_memory_consumer);
+			entries.clear();
+			lru.clear();
+			memory = 0;
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	int64_t SourceCache::_size_of(const Entry &p_entry) {
+		return sizeof(Entry) + MemoryBudget::size_of(p_entry.text);
+	}
+
+	void SourceCache::_erase(Map<String, Entry>::Element *p_entry) {
+		memory -= _size_of(p_entry->get());
+		lru.erase(p_entry->get().lru);
+		entries.erase(p_entry);
+	}
+
+	bool SourceCache::_read(const String &p_path, Entry &r_entry) {
+		FileAccess* f = FileAccess::open(p_path, FileAccess::READ);
+		if (!f)
+			return false;
+		int size = f->get_len();
+		uint64_t mtime = FileAccess::get_modified_time(p_path);
+		if (r_entry.checked_msec && r_entry.mtime == mtime && r_entry.size == size) {
+			memdelete(f);
+			return true;
+		}
+		Vector<uint8_t> buffer;
+		buffer.resize(size);
+		if (size)
+			f->get_buffer(buffer.ptr(), size);
+		memdelete(f);
+		r_entry.text = String();
+		if (size)
+			r_entry.text.parse_utf8((const char*)buffer.ptr(), size);
+		r_entry.mtime = mtime;
+		r_entry.size = size;
+		return true;
+	}
+
+	String SourceCache::get(const String &p_path) {
+		ERR_FAIL_COND_V(!mutex, String());
+		if (p_path.empty())
+			return String();
+
+		// The editor's copy wins, it holds what the user sees even before it is saved
+		if (ResourceCache::has(p_path)) {
+			// Held by reference, the editor may free its copy while the source is read
+			Ref<Script> script = Ref<Resource>(ResourceCache::get(p_path));
+			if (script.is_valid())
+				return script->get_source_code();
+		}
+
+		uint64_t now = OS::get_singleton()->get_ticks_msec();
+		mutex->lock();
+		Map<String, Entry>::Element *E = entries.find(p_path);
+		if (E && now - E->get().checked_msec < VALIDATE_INTERVAL_MSEC) {
+			E->get().last_used = MemoryBudget::tick();
+			lru.move_to_back(E->get().lru);
+			String text = E->get().text;
+			mutex->unlock();
+			return text;
+		}
+		Entry entry = E ? E->get() : Entry();
+		mutex->unlock();
+
+		// Read outside the lock, requests for other scripts go on meanwhile
+		bool known = entry.checked_msec != 0;
+		uint64_t mtime = entry.mtime;
+		int size = entry.size;
+		if (!_read(p_path, entry)) {
+			invalidate(p_path);
+			if (known)
+				ScriptDependencies::remove(p_path);
+			return String();
+		}
+		// Scripts that extend or load this one are stale when it changed on disk
+		if (known && (entry.mtime != mtime || entry.size != size))
+			ScriptDependencies::touch(p_path, entry.text.hash());
+		entry.checked_msec = now;
+		entry.last_used = MemoryBudget::tick();
+		mutex->lock();
+		// Replaces whatever the table holds by now, the entry may have been evicted meanwhile
+		E = entries.find(p_path);
+		if (E)
+			_erase(E);
+		entry.lru = lru.push_back(p_path);
+		memory += _size_of(entry);
+		entries[p_path] = entry;
+		mutex->unlock();
+		MemoryBudget::enforce();
+		return entry.text;
+	}
+
+	void SourceCache::invalidate(const String &p_path) {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		Map<String, Entry>::Element *E = entries.find(p_path);
+		if (E)
+			_erase(E);
+		mutex->unlock();
+	}
+
+	void SourceCache::clear() {
+		ERR_FAIL_COND(!mutex);
+		mutex->lock();
+		entries.clear();
+		lru.clear();
+		memory = 0;
+		mutex->unlock();
+	}
+
+	int64_t SourceCache::get_memory_usage() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	uint64_t SourceCache::get_oldest_use() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		mutex->lock();
+		uint64_t oldest = lru.front() ? entries[lru.front()->get()].last_used : 0;
+		mutex->unlock();
+		return oldest;
+	}
+
+	int64_t SourceCache::evict_oldest() {
+		ERR_FAIL_COND_V(!mutex, 0);
+		int64_t freed = 0;
+		mutex->lock();
+		Map<String, Entry>::Element *E = lru.front() ? entries.find(lru.front()->get()) : nullptr;
+		if (E) {
+			freed = _size_of(E->get());
+			_erase(E);
+		}
+		mutex->unlock();
+		return freed;
+	}
+
+}
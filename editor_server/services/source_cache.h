@@ -0,0 +1,54 @@
+#ifndef GD_EXPLORER_SOURCE_CACHE_H
+#define GD_EXPLORER_SOURCE_CACHE_H
+
+#include <core/ustring.h>
+#include <core/map.h>
+#include <core/os/mutex.h>
+
+namespace gdexplorer {
+
+	// Script sources for requests that only pass a path, shared by every service and thread
+	class SourceCache {
+	public:
+		enum {
+			// Entries checked more recently than this are returned without touching the file
+			VALIDATE_INTERVAL_MSEC = 500,
+		};
+
+		struct Entry {
+			uint64_t mtime = 0;
+			int size = 0;
+			uint64_t checked_msec = 0;
+			uint64_t last_used = 0;
+			List<String>::Element* lru = nullptr;
+			String text;
+		};
+
+	private:
+		static Mutex *mutex;
+		static Map<String, Entry> entries;
+		// Paths from least to most recently used
+		static List<String> lru;
+		static int64_t memory;
+		static bool _read(const String& p_path, Entry& r_entry);
+		static int64_t _size_of(const Entry& p_entry);
+		static void _erase(Map<String, Entry>::Element* p_entry);
+	public:
+		static void initialize();
+		static void finalize();
+
+		// Source of a res:// script. Scripts open in the editor give their unsaved text,
+		// others are read from disk again only when their modification time or size changed
+		static String get(const String& p_path);
+		static void invalidate(const String& p_path);
+		static void clear();
+		// Estimated bytes held
+		static int64_t get_memory_usage();
+		// Least recently used entry, for the memory budget
+		static uint64_t get_oldest_use();
+		static int64_t evict_oldest();
+	};
+
+}
+
+#endif // GD_EXPLORER_SOURCE_CACHE_H
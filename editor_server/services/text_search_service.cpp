@@ -0,0 +1,715 @@
+#include "text_search_service.h"
+#include <core/os/os.h>
+#include <core/os/thread.h>
+#include <core/os/semaphore.h>
+#include <core/os/file_access.h>
+#include <core/os/dir_access.h>
+#include <core/globals.h>
+#include <core/io/json.h>
+#include <string.h>
+#include <atomic>
+#include "../json_writer.h"
+#include "../trace.h"
+
+#ifdef UNIX_ENABLED
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gdexplorer {
+
+	static inline uint8_t _fold(uint8_t c) {
+		return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+	}
+
+	// First position not less than p_value
+	static int _lower_bound(const Vector<int>& p_ids, int p_value) {
+		int lo = 0, hi = p_ids.size();
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (p_ids[mid] < p_value)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	TextIndex::TextIndex(int p_refresh_interval_msec): refresh_interval_msec(p_refresh_interval_msec) {
+		mutex = Mutex::create();
+		MemoryBudget::add("text_index", this);
+	}
+
+	TextIndex::~TextIndex() {
+		MemoryBudget::remove(this);
+		memdelete(mutex);
+	}
+
+	bool TextIndex::is_text_file(const String &p_path) {
+		return p_path.ends_with(".gd") || p_path.ends_with(".tscn") || p_path.ends_with(".tres") || p_path.ends_with(".cfg");
+	}
+
+	void TextIndex::get_trigrams(const uint8_t *p_data, int p_len, Vector<uint32_t> &r_trigrams) {
+		r_trigrams.clear();
+		if (p_len < 3)
+			return;
+		r_trigrams.resize(p_len - 2);
+		uint32_t* w = r_trigrams.ptr();
+		uint32_t t = (uint32_t(_fold(p_data[0])) << 8) | _fold(p_data[1]);
+		for (int i = 2; i < p_len; i++) {
+			t = ((t << 8) | _fold(p_data[i])) & 0xFFFFFF;
+			w[i - 2] = t;
+		}
+		r_trigrams.sort();
+		int count = 0;
+		for (int i = 0; i < r_trigrams.size(); i++) {
+			if (i == 0 || w[i] != w[count - 1])
+				w[count++] = w[i];
+		}
+		r_trigrams.resize(count);
+	}
+
+	void TextIndex::_scan(const String &p_dir, Map<String, uint64_t> &r_files) const {
+		DirAccess* dir = DirAccess::open(p_dir);
+		if (!dir)
+			return;
+		Vector<String> subdirs;
+		dir->list_dir_begin();
+		String name = dir->get_next();
+		while (name != "") {
+			// Skips the navigation entries and hidden folders like .import and .vscode
+			if (!name.begins_with(".")) {
+				String path = p_dir.plus_file(name);
+				if (dir->current_is_dir())
+					subdirs.push_back(path);
+				else if (is_text_file(name))
+					r_files[path] = FileAccess::get_modified_time(path);
+			}
+			name = dir->get_next();
+		}
+		dir->list_dir_end();
+		memdelete(dir);
+		for (int i = 0; i < subdirs.size(); i++)
+			_scan(subdirs[i], r_files);
+	}
+
+	void TextIndex::refresh(bool p_force) {
+		uint64_t now = OS::get_singleton()->get_ticks_msec();
+		mutex->lock();
+		if (!p_force && last_refresh && now - last_refresh < uint64_t(refresh_interval_msec)) {
+			mutex->unlock();
+			return;
+		}
+		// Claimed before scanning so concurrent queries answer from what is indexed
+		last_refresh = now;
+		mutex->unlock();
+
+		EDITOR_SERVER_TRACE("text index refresh");
+		Map<String, uint64_t> found;
+		_scan("res://", found);
+
+		Vector<String> removed;
+		mutex->lock();
+		for (Map<String, int>::Element *E = ids.front(); E; E = E->next()) {
+			if (!found.has(E->key()))
+				removed.push_back(E->key());
+		}
+		mutex->unlock();
+		for (int i = 0; i < removed.size(); i++)
+			remove(removed[i]);
+
+		for (Map<String, uint64_t>::Element *E = found.front(); E; E = E->next()) {
+			mutex->lock();
+			const Map<String, int>::Element *I = ids.find(E->key());
+			bool changed = !I || files[I->get()].mtime != E->get();
+			mutex->unlock();
+			if (changed)
+				update(E->key());
+		}
+		mutex->lock();
+		built = true;
+		mutex->unlock();
+	}
+
+	void TextIndex::_unindex(int p_id) {
+		File& file = files[p_id];
+		for (int i = 0; i < file.trigrams.size(); i++) {
+			Map<uint32_t, Vector<int> >::Element *P = postings.find(file.trigrams[i]);
+			if (!P)
+				continue;
+			Vector<int>& posting = P->get();
+			int pos = _lower_bound(posting, p_id);
+			if (pos < posting.size() && posting[pos] == p_id)
+				posting.remove(pos);
+			if (posting.empty())
+				postings.erase(P);
+		}
+		memory -= file.trigrams.size() * (sizeof(uint32_t) + sizeof(int));
+		file.trigrams.clear();
+	}
+
+	void TextIndex::update(const String &p_path) {
+		FileAccess* f = FileAccess::open(p_path, FileAccess::READ);
+		if (!f) {
+			remove(p_path);
+			return;
+		}
+		int len = f->get_len();
+		if (len > MAX_FILE_SIZE) {
+			memdelete(f);
+			remove(p_path);
+			return;
+		}
+		Vector<uint8_t> bytes;
+		bytes.resize(len);
+		if (len)
+			f->get_buffer(bytes.ptr(), len);
+		memdelete(f);
+
+		// Trigrams are collected outside the lock, only the postings are touched under it
+		Vector<uint32_t> trigrams;
+		get_trigrams(bytes.ptr(), len, trigrams);
+
+		mutex->lock();
+		int id;
+		Map<String, int>::Element *E = ids.find(p_path);
+		if (E) {
+			id = E->get();
+			_unindex(id);
+		} else if (free_ids.size()) {
+			id = free_ids[free_ids.size() - 1];
+			free_ids.resize(free_ids.size() - 1);
+			ids[p_path] = id;
+			memory += 2 * MemoryBudget::size_of(p_path);
+		} else {
+			id = files.size();
+			files.resize(id + 1);
+			ids[p_path] = id;
+			memory += sizeof(File) + 2 * MemoryBudget::size_of(p_path);
+		}
+		File& file = files[id];
+		file.path = p_path;
+		file.mtime = FileAccess::get_modified_time(p_path);
+		file.trigrams = trigrams;
+		for (int i = 0; i < trigrams.size(); i++) {
+			Vector<int>& posting = postings[trigrams[i]];
+			if (posting.empty() || posting[posting.size() - 1] < id)
+				posting.push_back(id);
+			else
+				posting.insert(_lower_bound(posting, id), id);
+		}
+		memory += trigrams.size() * (sizeof(uint32_t) + sizeof(int));
+		version++;
+		mutex->unlock();
+		MemoryBudget::enforce();
+	}
+
+	void TextIndex::remove(const String &p_path) {
+		mutex->lock();
+		Map<String, int>::Element *E = ids.find(p_path);
+		if (E) {
+			int id = E->get();
+			_unindex(id);
+			memory -= 2 * MemoryBudget::size_of(files[id].path);
+			files[id] = File();
+			free_ids.push_back(id);
+			ids.erase(E);
+			version++;
+		}
+		mutex->unlock();
+	}
+
+	void TextIndex::get_candidates(const CharString &p_text, const String &p_prefix, Vector<String> &r_paths) const {
+		Vector<uint32_t> trigrams;
+		get_trigrams((const uint8_t*)p_text.get_data(), p_text.length(), trigrams);
+
+		mutex->lock();
+		if (trigrams.empty()) {
+			for (const Map<String, int>::Element *E = ids.front(); E; E = E->next()) {
+				if (E->key().begins_with(p_prefix))
+					r_paths.push_back(E->key());
+			}
+			mutex->unlock();
+			return;
+		}
+		// Intersects starting from the rarest trigram
+		Vector<const Vector<int>*> lists;
+		for (int i = 0; i < trigrams.size(); i++) {
+			const Map<uint32_t, Vector<int> >::Element *P = postings.find(trigrams[i]);
+			if (!P) {
+				mutex->unlock();
+				return;
+			}
+			const Vector<int>* posting = &P->get();
+			int pos = lists.size();
+			while (pos > 0 && lists[pos - 1]->size() > posting->size())
+				pos--;
+			lists.insert(pos, posting);
+		}
+		Vector<int> result = *lists[0];
+		for (int i = 1; i < lists.size() && result.size(); i++) {
+			const Vector<int>& other = *lists[i];
+			int count = 0;
+			int o = 0;
+			for (int j = 0; j < result.size(); j++) {
+				while (o < other.size() && other[o] < result[j])
+					o++;
+				if (o < other.size() && other[o] == result[j])
+					result[count++] = result[j];
+			}
+			result.resize(count);
+		}
+		for (int i = 0; i < result.size(); i++) {
+			const String& path = files[result[i]].path;
+			if (path.begins_with(p_prefix))
+				r_paths.push_back(path);
+		}
+		mutex->unlock();
+	}
+
+	bool TextIndex::is_built() const {
+		mutex->lock();
+		bool b = built;
+		mutex->unlock();
+		return b;
+	}
+
+	int TextIndex::get_file_count() const {
+		mutex->lock();
+		int count = ids.size();
+		mutex->unlock();
+		return count;
+	}
+
+	uint64_t TextIndex::get_version() const {
+		mutex->lock();
+		uint64_t v = version;
+		mutex->unlock();
+		return v;
+	}
+
+	int64_t TextIndex::get_memory_usage() const {
+		mutex->lock();
+		int64_t bytes = memory;
+		mutex->unlock();
+		return bytes;
+	}
+
+	namespace {
+		// Contents of a file, mapped where the platform allows it instead of copied
+		class MappedFile {
+			const uint8_t* data = nullptr;
+			int size = 0;
+			Vector<uint8_t> buffer;
+#ifdef UNIX_ENABLED
+			void* map = nullptr;
+#endif
+		public:
+			bool open(const String& p_path) {
+#ifdef UNIX_ENABLED
+				CharString os_path = GlobalConfig::get_singleton()->globalize_path(p_path).utf8();
+				int fd = ::open(os_path.get_data(), O_RDONLY);
+				if (fd >= 0) {
+					struct stat st;
+					bool mapped = false;
+					if (fstat(fd, &st) == 0) {
+						// Empty files can not be mapped and have nothing to match anyway
+						mapped = st.st_size == 0;
+						if (st.st_size > 0 && st.st_size <= TextIndex::MAX_FILE_SIZE) {
+							void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+							if (m != MAP_FAILED) {
+								map = m;
+								data = (const uint8_t*)m;
+								size = st.st_size;
+								mapped = true;
+							}
+						}
+					}
+					::close(fd);
+					if (mapped)
+						return true;
+				}
+#endif
+				FileAccess* f = FileAccess::open(p_path, FileAccess::READ);
+				if (!f)
+					return false;
+				int len = MIN(int(f->get_len()), int(TextIndex::MAX_FILE_SIZE));
+				buffer.resize(len);
+				if (len)
+					f->get_buffer(buffer.ptr(), len);
+				memdelete(f);
+				data = buffer.ptr();
+				size = len;
+				return true;
+			}
+			const uint8_t* ptr() const { return data; }
+			int get_size() const { return size; }
+			~MappedFile() {
+#ifdef UNIX_ENABLED
+				if (map)
+					munmap(map, size);
+#endif
+			}
+		};
+
+		struct Match {
+			int line;
+			int column;
+			String text;
+		};
+
+		struct FileMatches {
+			String path;
+			Vector<Match> matches;
+		};
+
+		// Shared by the verification threads and the one writing the response
+		struct Search {
+			Vector<String> candidates;
+			CharString pattern;
+			bool case_sensitive;
+			ServiceDeadline deadline;
+			std::atomic<int> remaining;
+			std::atomic<int> scanned;
+			std::atomic<bool> truncated;
+
+			// Handed out by the pool under its lock
+			int next = 0;
+			Mutex *mutex;
+			Semaphore *ready;
+			List<FileMatches*> results;
+			int completed = 0;
+			// No more candidates are handed out, the search ends once the last taken one completed
+			bool closed = false;
+		};
+
+		int _find(const uint8_t* p_data, int p_size, int p_from, const CharString& p_pattern, bool p_case_sensitive) {
+			const uint8_t* pattern = (const uint8_t*)p_pattern.get_data();
+			int len = p_pattern.length();
+			if (p_case_sensitive) {
+				for (int i = p_from; i + len <= p_size; ) {
+					const uint8_t* c = (const uint8_t*)memchr(p_data + i, pattern[0], p_size - len - i + 1);
+					if (!c)
+						return -1;
+					i = c - p_data;
+					if (memcmp(p_data + i, pattern, len) == 0)
+						return i;
+					i++;
+				}
+				return -1;
+			}
+			// The pattern is already folded
+			for (int i = p_from; i + len <= p_size; i++) {
+				if (_fold(p_data[i]) != pattern[0])
+					continue;
+				int j = 1;
+				while (j < len && _fold(p_data[i + j]) == pattern[j])
+					j++;
+				if (j == len)
+					return i;
+			}
+			return -1;
+		}
+
+		void _scan_file(Search* p_search, const String& p_path, FileMatches& r_matches) {
+			MappedFile file;
+			if (!file.open(p_path))
+				return;
+			const uint8_t* data = file.ptr();
+			int size = file.get_size();
+			int line = 1;
+			int line_start = 0;
+			int counted = 0;
+			int pos = _find(data, size, 0, p_search->pattern, p_search->case_sensitive);
+			while (pos >= 0) {
+				if (p_search->remaining.fetch_sub(1) <= 0) {
+					p_search->truncated = true;
+					break;
+				}
+				// Lines are counted from the previous match onwards
+				while (counted < pos) {
+					const uint8_t* nl = (const uint8_t*)memchr(data + counted, '\n', pos - counted);
+					if (!nl) {
+						counted = pos;
+						break;
+					}
+					line++;
+					counted = nl - data + 1;
+					line_start = counted;
+				}
+				Match m;
+				m.line = line;
+				// Characters, not bytes, continuation bytes of UTF-8 are skipped
+				m.column = 1;
+				for (int i = line_start; i < pos; i++) {
+					if ((data[i] & 0xC0) != 0x80)
+						m.column++;
+				}
+				int end = line_start;
+				while (end < size && end - line_start < TextSearchService::MAX_PREVIEW && data[end] != '\n')
+					end++;
+				// A cut preview must not split a character
+				while (end < size && end > line_start && (data[end] & 0xC0) == 0x80)
+					end--;
+				if (end > line_start && data[end - 1] == '\r')
+					end--;
+				m.text.parse_utf8((const char*)data + line_start, end - line_start);
+				r_matches.matches.push_back(m);
+				pos = _find(data, size, pos + p_search->pattern.length(), p_search->pattern, p_search->case_sensitive);
+			}
+		}
+	}
+
+	struct TextSearchService::VerifyPool {
+		Mutex *mutex;
+		Semaphore *work;
+		List<Search*> active;
+		Vector<Thread*> threads;
+		bool quit = false;
+
+		// Next candidate of the search that waited longest, searches take turns file by file
+		Search* take(int& r_idx) {
+			mutex->lock();
+			while (active.size()) {
+				Search* search = active.front()->get();
+				active.pop_front();
+				if (search->next < search->candidates.size() && !search->truncated.load() && !search->deadline.expired()) {
+					r_idx = search->next++;
+					active.push_back(search);
+					mutex->unlock();
+					return search;
+				}
+				search->mutex->lock();
+				search->closed = true;
+				search->mutex->unlock();
+				search->ready->post();
+			}
+			mutex->unlock();
+			return nullptr;
+		}
+
+		static void worker(void* p_pool) {
+			VerifyPool* pool = (VerifyPool*)p_pool;
+			while (true) {
+				pool->work->wait();
+				if (pool->quit)
+					break;
+				int idx;
+				while (Search* search = pool->take(idx)) {
+					FileMatches* file = memnew(FileMatches);
+					file->path = search->candidates[idx];
+					_scan_file(search, file->path, *file);
+					search->scanned++;
+					search->mutex->lock();
+					if (file->matches.empty())
+						memdelete(file);
+					else
+						search->results.push_back(file);
+					search->completed++;
+					search->mutex->unlock();
+					search->ready->post();
+				}
+			}
+		}
+
+		void submit(Search* p_search) {
+			mutex->lock();
+			active.push_back(p_search);
+			mutex->unlock();
+			int wake = MIN(threads.size(), p_search->candidates.size());
+			for (int i = 0; i < wake; i++)
+				work->post();
+		}
+
+		VerifyPool(int p_threads) {
+			mutex = Mutex::create();
+			work = Semaphore::create();
+			for (int i = 0; i < p_threads; i++)
+				threads.push_back(Thread::create(worker, this));
+		}
+
+		~VerifyPool() {
+			quit = true;
+			for (int i = 0; i < threads.size(); i++)
+				work->post();
+			for (int i = 0; i < threads.size(); i++) {
+				Thread::wait_to_finish(threads[i]);
+				memdelete(threads[i]);
+			}
+			memdelete(work);
+			memdelete(mutex);
+		}
+	};
+
+	TextSearchService::Request::Request(const Dictionary &request) {
+		text = request.has("text")? request["text"]:"";
+		prefix = request.has("prefix")? request["prefix"]:"res://";
+		if (prefix != "res://")
+			prefix = GlobalConfig::get_singleton()->localize_path(prefix);
+		case_sensitive = request.has("case_sensitive")? bool(request["case_sensitive"]) : false;
+		max_results = request.has("max_results")? int(request["max_results"]) : int(DEFAULT_MAX_RESULTS);
+		if (max_results <= 0)
+			max_results = DEFAULT_MAX_RESULTS;
+	}
+
+	TextSearchService::TextSearchService() {
+		index = memnew(TextIndex);
+		start_mutex = Mutex::create();
+	}
+
+	TextSearchService::~TextSearchService() {
+		quit = true;
+		if (refresh_thread) {
+			Thread::wait_to_finish(refresh_thread);
+			memdelete(refresh_thread);
+		}
+		if (pool)
+			memdelete(pool);
+		memdelete(start_mutex);
+		memdelete(index);
+	}
+
+	void TextSearchService::_refresh_thread(void *p_self) {
+		TextSearchService* self = (TextSearchService*)p_self;
+		while (!self->quit) {
+			self->index->refresh();
+			OS::get_singleton()->delay_usec(100000);
+		}
+	}
+
+	void TextSearchService::_start() const {
+		// Started with the first search, services can exist without ever being asked
+		start_mutex->lock();
+		if (!refresh_thread) {
+			refresh_thread = Thread::create(_refresh_thread, const_cast<TextSearchService*>(this));
+			// Half the cores, the other half stays with the request workers
+			pool = memnew(VerifyPool(MAX(OS::get_singleton()->get_processor_count() / 2, 1)));
+		}
+		start_mutex->unlock();
+	}
+
+	void TextSearchService::_write_result(JSONWriter &p_writer, const Request &p_request) const {
+		_start();
+		Search search;
+		search.pattern = p_request.text.utf8();
+		search.case_sensitive = p_request.case_sensitive;
+		search.deadline = p_request.deadline;
+		search.remaining = p_request.max_results;
+		search.scanned = 0;
+		search.truncated = false;
+		if (!search.case_sensitive) {
+			for (int i = 0; i < search.pattern.length(); i++)
+				search.pattern[i] = _fold(search.pattern[i]);
+		}
+		if (search.pattern.length()) {
+			EDITOR_SERVER_TRACE("text index lookup");
+			index->get_candidates(search.pattern, p_request.prefix, search.candidates);
+		}
+
+		p_writer.begin_object();
+		p_writer.key("candidates");
+		p_writer.value(search.candidates.size());
+		p_writer.key("matches");
+		p_writer.begin_array();
+
+		if (search.candidates.size()) {
+			EDITOR_SERVER_TRACE("verify candidates");
+			search.mutex = Mutex::create();
+			search.ready = Semaphore::create();
+			pool->submit(&search);
+
+			// Matches go out file by file as the pool finds them
+			bool done = false;
+			while (!done) {
+				search.ready->wait();
+				search.mutex->lock();
+				List<FileMatches*> results;
+				while (search.results.size()) {
+					results.push_back(search.results.front()->get());
+					search.results.pop_front();
+				}
+				done = search.closed && search.completed == search.next;
+				search.mutex->unlock();
+				for (List<FileMatches*>::Element *E = results.front(); E; E = E->next()) {
+					const FileMatches* file = E->get();
+					for (int i = 0; i < file->matches.size(); i++) {
+						const Match& m = file->matches[i];
+						p_writer.begin_object();
+						p_writer.key("path");
+						p_writer.value(file->path);
+						p_writer.key("line");
+						p_writer.value(m.line);
+						p_writer.key("column");
+						p_writer.value(m.column);
+						p_writer.key("text");
+						p_writer.value(m.text);
+						p_writer.end_object();
+					}
+					memdelete(E->get());
+				}
+				p_writer.flush();
+			}
+			memdelete(search.ready);
+			memdelete(search.mutex);
+		}
+		p_writer.end_array();
+		p_writer.key("scanned");
+		p_writer.value(search.scanned.load());
+		if (search.truncated.load()) {
+			p_writer.key("truncated");
+			p_writer.value(true);
+		}
+		// Until the first refresh is through, files not indexed yet are not searched
+		if (search.scanned.load() < search.candidates.size() || !index->is_built()) {
+			p_writer.key("partial");
+			p_writer.value(true);
+		}
+		p_writer.end_object();
+	}
+
+	String TextSearchService::get_etag(const Dictionary &data) const {
+		if (get_script_instance())
+			return String();
+		_start();
+		// Answers from an index that is still being built must not be reused
+		if (!index->is_built())
+			return String();
+		return itos(index->get_version());
+	}
+
+	bool TextSearchService::resolve_stream(const Dictionary &_data, JSONWriter &p_writer) const {
+		if (get_script_instance())
+			return false;
+		Request request(_data["request"]);
+		request.deadline = ServiceDeadline::from_request(_data);
+		p_writer.begin_object();
+		write_fields(p_writer, _data, "result");
+		p_writer.key("result");
+		_write_result(p_writer, request);
+		p_writer.end_object();
+		return true;
+	}
+
+	Dictionary TextSearchService::resolve(const Dictionary &_data) const {
+		Dictionary data(_data);
+		Request request(data["request"]);
+		request.deadline = ServiceDeadline::from_request(data);
+
+		JSONBufferSink sink;
+		{
+			JSONWriter writer(&sink);
+			_write_result(writer, request);
+		}
+		Variant result;
+		String errmsg;
+		int errline = -1;
+		String json;
+		json.parse_utf8((const char*)sink.ptr(), sink.size());
+		if (JSON::parse(json, result, errmsg, errline) == OK)
+			data["result"] = result;
+		return super::resolve(data);
+	}
+
+}
@@ -0,0 +1,115 @@
+#ifndef GD_EXPLORER_TEXT_SEARCH_SERVICE_H
+#define GD_EXPLORER_TEXT_SEARCH_SERVICE_H
+
+#include "service.h"
+#include <core/os/mutex.h>
+#include <core/os/thread.h>
+#include "../memory_budget.h"
+
+namespace gdexplorer {
+
+	// Trigrams of the project's text resources, narrows the files a search has to read
+	class TextIndex : public MemoryBudget::Consumer {
+	public:
+		enum {
+			// Bigger files are not indexed and so never searched
+			MAX_FILE_SIZE = 4 * 1024 * 1024,
+		};
+
+	private:
+		struct File {
+			String path;
+			uint64_t mtime = 0;
+			// Sorted and unique, needed to take the file out of the postings again
+			Vector<uint32_t> trigrams;
+		};
+
+		// Ids index files, freed ids are reused so the postings stay dense
+		Vector<File> files;
+		Vector<int> free_ids;
+		Map<String, int> ids;
+		// File ids containing a trigram, sorted
+		Map<uint32_t, Vector<int> > postings;
+		Mutex *mutex;
+		uint64_t last_refresh = 0;
+		uint64_t version = 0;
+		bool built = false;
+		// Trigrams are counted once in the file and once in the posting, map nodes are left out
+		int64_t memory = 0;
+		int refresh_interval_msec;
+
+		void _scan(const String& p_dir, Map<String, uint64_t>& r_files) const;
+		void _unindex(int p_id);
+	public:
+		static bool is_text_file(const String& p_path);
+		// ASCII letters are folded to lower case, searches are case insensitive up to the verification
+		static void get_trigrams(const uint8_t* p_data, int p_len, Vector<uint32_t>& r_trigrams);
+
+		// Reindexes files whose modification time changed and drops deleted ones.
+		// Unless forced, does nothing when the last refresh is more recent than the interval
+		void refresh(bool p_force = false);
+		void update(const String& p_path);
+		void remove(const String& p_path);
+
+		// Files under p_prefix that contain every trigram of p_text, all of them when it is shorter than a trigram
+		void get_candidates(const CharString& p_text, const String& p_prefix, Vector<String>& r_paths) const;
+		int get_file_count() const;
+		// Set once the first refresh went through the whole project
+		bool is_built() const;
+		// Changes whenever a file is added, reindexed or dropped
+		uint64_t get_version() const;
+		// Counted against the memory budget, never evicted since a search needs every file
+		virtual int64_t get_memory_usage() const override;
+
+		TextIndex(int p_refresh_interval_msec = 1000);
+		~TextIndex();
+	};
+
+	// Find in files over .gd, .tscn, .tres and .cfg files, candidates from the index are verified in parallel
+	class TextSearchService : public EditorServerService {
+		GDCLASS(TextSearchService, EditorServerService);
+		using super = EditorServerService;
+	public:
+		enum {
+			DEFAULT_MAX_RESULTS = 1000,
+			// Bytes of the matching line sent along with a match
+			MAX_PREVIEW = 256,
+		};
+
+		struct Request {
+			String text;
+			String prefix;
+			bool case_sensitive;
+			int max_results;
+			ServiceDeadline deadline;
+			Request(const Dictionary& dict);
+		};
+
+		// Threads verifying candidates, shared by every search so concurrent ones do not add threads
+		struct VerifyPool;
+
+	protected:
+		TextIndex *index;
+		mutable VerifyPool *pool = nullptr;
+		// Keeps the index current in the background, requests never read files to update it
+		mutable Thread *refresh_thread = nullptr;
+		Mutex *start_mutex;
+		bool quit = false;
+
+		static void _refresh_thread(void* p_self);
+		void _start() const;
+		void _write_result(JSONWriter& p_writer, const Request& p_request) const;
+	public:
+		TextIndex* get_index() const { return index; }
+
+		virtual Dictionary resolve(const Dictionary& _data) const override;
+		virtual bool resolve_stream(const Dictionary& _data, JSONWriter& p_writer) const override;
+		virtual bool can_coalesce(const Dictionary& data) const override { return true; }
+		virtual String get_etag(const Dictionary& data) const override;
+		TextSearchService();
+		virtual ~TextSearchService();
+	};
+
+}
+
+#endif // GD_EXPLORER_TEXT_SEARCH_SERVICE_H
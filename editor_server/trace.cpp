@@ -0,0 +1,135 @@
+#include "trace.h"
+#include <core/os/os.h>
+#include <core/os/file_access.h>
+#include "json_writer.h"
+
+namespace gdexplorer {
+
+	std::atomic<bool> EditorServerTrace::enabled(false);
+	std::atomic<EditorServerTrace::Ring*> EditorServerTrace::rings(nullptr);
+	std::atomic<uint32_t> EditorServerTrace::epoch(0);
+
+	namespace {
+		// Hands the ring back for reuse once its thread ends
+		struct ThreadRing {
+			EditorServerTrace::Ring* ring = nullptr;
+			~ThreadRing() {
+				if (ring)
+					ring->in_use.store(false, std::memory_order_release);
+			}
+		};
+		thread_local ThreadRing _thread_ring;
+		std::atomic<int> _ring_ids(0);
+	}
+
+	EditorServerTrace::Ring* EditorServerTrace::_acquire_ring() {
+		for (Ring* r = rings.load(std::memory_order_acquire); r; r = r->next) {
+			bool expected = false;
+			if (r->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+				return r;
+		}
+		// Rings are never freed, their number is bounded by the peak of concurrent threads
+		Ring* r = memnew(Ring);
+		r->id = ++_ring_ids;
+		r->head.store(0, std::memory_order_relaxed);
+		r->epoch.store(epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+		r->in_use.store(true, std::memory_order_relaxed);
+		r->next = rings.load(std::memory_order_relaxed);
+		while (!rings.compare_exchange_weak(r->next, r, std::memory_order_acq_rel)) {}
+		return r;
+	}
+
+	void EditorServerTrace::set_enabled(bool p_enabled) {
+		enabled.store(p_enabled, std::memory_order_relaxed);
+	}
+
+	void EditorServerTrace::record(const char *p_name, uint64_t p_begin_usec, uint64_t p_end_usec) {
+		if (!is_enabled())
+			return;
+		if (!_thread_ring.ring)
+			_thread_ring.ring = _acquire_ring();
+		Ring* r = _thread_ring.ring;
+		uint32_t current = epoch.load(std::memory_order_acquire);
+		if (r->epoch.load(std::memory_order_relaxed) != current) {
+			r->head.store(0, std::memory_order_relaxed);
+			r->epoch.store(current, std::memory_order_release);
+		}
+		uint32_t head = r->head.load(std::memory_order_relaxed);
+		Event& e = r->events[head % RING_SIZE];
+		e.name = p_name;
+		e.begin_usec = p_begin_usec;
+		e.duration_usec = p_end_usec - p_begin_usec;
+		r->head.store(head + 1, std::memory_order_release);
+	}
+
+	void EditorServerTrace::clear() {
+		epoch.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	int EditorServerTrace::write_chrome_trace(JSONWriter &p_writer) {
+		int count = 0;
+		p_writer.begin_object();
+		p_writer.key("displayTimeUnit");
+		p_writer.value("ms");
+		p_writer.key("traceEvents");
+		p_writer.begin_array();
+		uint32_t current = epoch.load(std::memory_order_acquire);
+		for (Ring* r = rings.load(std::memory_order_acquire); r; r = r->next) {
+			// Not emptied since the last clear, everything in it is older
+			if (r->epoch.load(std::memory_order_acquire) != current)
+				continue;
+			uint32_t head = r->head.load(std::memory_order_acquire);
+			uint32_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+			for (uint32_t i = first; i < head; i++) {
+				// A busy thread may overwrite the oldest slots while they are read, tolerable for a profile
+				const Event& e = r->events[i % RING_SIZE];
+				p_writer.begin_object();
+				p_writer.key("name");
+				p_writer.value(e.name);
+				p_writer.key("ph");
+				p_writer.value("X");
+				p_writer.key("ts");
+				p_writer.value(int64_t(e.begin_usec));
+				p_writer.key("dur");
+				p_writer.value(int64_t(e.duration_usec));
+				p_writer.key("pid");
+				p_writer.value(1);
+				p_writer.key("tid");
+				p_writer.value(r->id);
+				p_writer.end_object();
+				count++;
+			}
+		}
+		p_writer.end_array();
+		p_writer.end_object();
+		return count;
+	}
+
+	Error EditorServerTrace::dump(const String &p_path, int *r_events) {
+		FileAccess* file = FileAccess::open(p_path, FileAccess::WRITE);
+		if (!file)
+			return ERR_CANT_CREATE;
+		Error err;
+		{
+			JSONFileSink sink(file);
+			JSONWriter writer(&sink);
+			int events = write_chrome_trace(writer);
+			if (r_events)
+				*r_events = events;
+			err = writer.flush();
+		}
+		file->close();
+		memdelete(file);
+		return err;
+	}
+
+	EditorServerTraceScope::EditorServerTraceScope(const char *p_name): name(p_name) {
+		begin = EditorServerTrace::is_enabled() ? OS::get_singleton()->get_ticks_usec() : 0;
+	}
+
+	EditorServerTraceScope::~EditorServerTraceScope() {
+		if (begin)
+			EditorServerTrace::record(name, begin, OS::get_singleton()->get_ticks_usec());
+	}
+
+}
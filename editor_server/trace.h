@@ -0,0 +1,63 @@
+#ifndef GD_EXPLORER_TRACE_H
+#define GD_EXPLORER_TRACE_H
+
+#include <core/ustring.h>
+#include <atomic>
+
+namespace gdexplorer {
+
+	class JSONWriter;
+
+	// Opt-in request lifecycle spans, exported in the Chrome trace event format
+	class EditorServerTrace {
+	public:
+		enum { RING_SIZE = 4096 };
+
+		struct Event {
+			const char* name;
+			uint64_t begin_usec;
+			uint64_t duration_usec;
+		};
+
+		// Written only by the thread owning it, so recording takes no lock
+		struct Ring {
+			int id;
+			std::atomic<uint32_t> head;
+			// Clears since the owner last emptied the ring, events of an older epoch are not shown
+			std::atomic<uint32_t> epoch;
+			std::atomic<bool> in_use;
+			Event events[RING_SIZE];
+			Ring* next;
+		};
+
+	private:
+		static std::atomic<bool> enabled;
+		static std::atomic<Ring*> rings;
+		static std::atomic<uint32_t> epoch;
+		static Ring* _acquire_ring();
+	public:
+		static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+		static void set_enabled(bool p_enabled);
+		static void record(const char* p_name, uint64_t p_begin_usec, uint64_t p_end_usec);
+		// Each ring is emptied by its own thread on its next event, other threads never write its head
+		static void clear();
+		// Events still in the rings, older ones are overwritten
+		static int write_chrome_trace(JSONWriter& p_writer);
+		static Error dump(const String& p_path, int* r_events = nullptr);
+	};
+
+	class EditorServerTraceScope {
+		const char* name;
+		uint64_t begin;
+	public:
+		EditorServerTraceScope(const char* p_name);
+		~EditorServerTraceScope();
+	};
+
+#define _EDITOR_SERVER_TRACE_JOIN(a, b) a##b
+#define _EDITOR_SERVER_TRACE_NAME(line) _EDITOR_SERVER_TRACE_JOIN(_trace_scope_, line)
+#define EDITOR_SERVER_TRACE(m_name) ::gdexplorer::EditorServerTraceScope _EDITOR_SERVER_TRACE_NAME(__LINE__)(m_name)
+
+}
+
+#endif // GD_EXPLORER_TRACE_H
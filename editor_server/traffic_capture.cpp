@@ -0,0 +1,280 @@
+#include "traffic_capture.h"
+#include "editor_server.h"
+#include <core/os/os.h>
+#include <core/os/thread.h>
+#include <core/io/ip.h>
+#include <core/io/stream_peer_tcp.h>
+
+namespace gdexplorer {
+
+	Mutex *TrafficCapture::mutex = nullptr;
+	FileAccess *TrafficCapture::file = nullptr;
+	uint64_t TrafficCapture::start_usec = 0;
+	int TrafficCapture::records = 0;
+
+	void TrafficCapture::initialize() {
+		if (!mutex)
+			mutex = Mutex::create();
+	}
+
+	void TrafficCapture::finalize() {
+		stop();
+		if (mutex) {
+			memdelete(mutex);
+			mutex = nullptr;
+		}
+	}
+
+	Error TrafficCapture::start(const String &p_path) {
+		ERR_FAIL_COND_V(!mutex, ERR_UNCONFIGURED);
+		stop();
+		FileAccess* f = FileAccess::open(p_path, FileAccess::WRITE);
+		if (!f)
+			return ERR_CANT_CREATE;
+		f->store_buffer((const uint8_t*)"GDTC", 4);
+		f->store_32(FORMAT_VERSION);
+		mutex->lock();
+		file = f;
+		records = 0;
+		start_usec = OS::get_singleton()->get_ticks_usec();
+		mutex->unlock();
+		return OK;
+	}
+
+	int TrafficCapture::stop() {
+		if (!mutex)
+			return 0;
+		mutex->lock();
+		int count = records;
+		if (file) {
+			file->close();
+			memdelete(file);
+			file = nullptr;
+		}
+		mutex->unlock();
+		return count;
+	}
+
+	void TrafficCapture::record(uint64_t p_arrival_usec, uint64_t p_done_usec, const uint8_t *p_body, int p_len) {
+		mutex->lock();
+		if (file) {
+			file->store_64(p_arrival_usec > start_usec ? p_arrival_usec - start_usec : 0);
+			file->store_32(uint32_t(p_done_usec - p_arrival_usec));
+			file->store_32(p_len);
+			file->store_buffer(p_body, p_len);
+			records++;
+		}
+		mutex->unlock();
+	}
+
+	Error TrafficCapture::load(const String &p_path, Vector<Record> &r_records) {
+		FileAccess* f = FileAccess::open(p_path, FileAccess::READ);
+		if (!f)
+			return ERR_FILE_CANT_OPEN;
+		uint8_t magic[4];
+		f->get_buffer(magic, 4);
+		if (magic[0] != 'G' || magic[1] != 'D' || magic[2] != 'T' || magic[3] != 'C' || f->get_32() != FORMAT_VERSION) {
+			memdelete(f);
+			return ERR_FILE_UNRECOGNIZED;
+		}
+		while (f->get_pos() < f->get_len()) {
+			Record r;
+			r.arrival_usec = f->get_64();
+			r.latency_usec = f->get_32();
+			uint32_t len = f->get_32();
+			// A truncated capture ends with a partial record, the server never accepted bodies this big anyway
+			if (len > uint32_t(EditorServer::MAX_BODY_SIZE) || len > f->get_len() - f->get_pos())
+				break;
+			r.body.resize(len);
+			if (len && f->get_buffer(r.body.ptr(), len) != int(len))
+				break;
+			r_records.push_back(r);
+		}
+		memdelete(f);
+		return OK;
+	}
+
+	namespace {
+
+		struct ReplayWorker {
+			const Vector<TrafficCapture::Record>* records;
+			const TrafficReplay::Options* options;
+			int index;
+			uint64_t start_usec;
+			Vector<uint32_t> latencies;
+			int errors = 0;
+			Thread* thread = nullptr;
+		};
+
+		bool _read_line(const Ref<StreamPeerTCP>& p_peer, String& r_line) {
+			CharString line;
+			uint8_t c;
+			while (p_peer->get_data(&c, 1) == OK) {
+				if (c == '\n') {
+					line.push_back(0);
+					r_line.parse_utf8(line.get_data());
+					r_line = r_line.strip_edges();
+					return true;
+				}
+				line.push_back(c);
+			}
+			return false;
+		}
+
+		bool _skip(const Ref<StreamPeerTCP>& p_peer, int p_bytes) {
+			uint8_t buf[4096];
+			while (p_bytes > 0) {
+				int n = MIN(p_bytes, int(sizeof(buf)));
+				if (p_peer->get_data(buf, n) != OK)
+					return false;
+				p_bytes -= n;
+			}
+			return true;
+		}
+
+		// Reads and discards one response, content-length or chunked
+		bool _read_response(const Ref<StreamPeerTCP>& p_peer) {
+			String line;
+			int length = 0;
+			bool chunked = false;
+			if (!_read_line(p_peer, line) || !line.begins_with("HTTP/"))
+				return false;
+			while (_read_line(p_peer, line) && !line.empty()) {
+				String lower = line.to_lower();
+				if (lower.begins_with("content-length:"))
+					length = lower.substr(15, lower.length()).strip_edges().to_int();
+				else if (lower.begins_with("transfer-encoding:") && lower.find("chunked") != -1)
+					chunked = true;
+			}
+			if (!chunked)
+				return _skip(p_peer, length);
+			while (_read_line(p_peer, line)) {
+				int size = line.hex_to_int(false);
+				if (!_skip(p_peer, size + 2))
+					return false;
+				if (size == 0)
+					return true;
+			}
+			return false;
+		}
+
+		Ref<StreamPeerTCP> _connect(const TrafficReplay::Options& p_options) {
+			Ref<StreamPeerTCP> peer = StreamPeerTCP::create_ref();
+			IP_Address ip = IP::get_singleton()->resolve_hostname(p_options.host);
+			if (peer->connect_to_host(ip, p_options.port) != OK)
+				return Ref<StreamPeerTCP>();
+			for (int i = 0; i < 500 && peer->get_status() == StreamPeerTCP::STATUS_CONNECTING; i++)
+				OS::get_singleton()->delay_usec(10000);
+			if (peer->get_status() != StreamPeerTCP::STATUS_CONNECTED)
+				return Ref<StreamPeerTCP>();
+			peer->set_nodelay(true);
+			return peer;
+		}
+
+		void _replay_worker(void* p_worker) {
+			ReplayWorker* w = (ReplayWorker*)p_worker;
+			Ref<StreamPeerTCP> peer = _connect(*w->options);
+			const Vector<TrafficCapture::Record>& records = *w->records;
+			for (int i = w->index; i < records.size(); i += w->options->concurrency) {
+				const TrafficCapture::Record& r = records[i];
+				if (w->options->speed > 0) {
+					uint64_t due = w->start_usec + uint64_t(r.arrival_usec / w->options->speed);
+					uint64_t now = OS::get_singleton()->get_ticks_usec();
+					if (due > now)
+						OS::get_singleton()->delay_usec(due - now);
+				}
+				if (peer.is_null() || !peer->is_connected_to_host())
+					peer = _connect(*w->options);
+				if (peer.is_null()) {
+					w->errors++;
+					continue;
+				}
+
+				String head = "POST / HTTP/1.1\r\nconnection: keep-alive\r\ncontent-type: application/json\r\ncontent-length: " + itos(r.body.size()) + "\r\n\r\n";
+				CharString head_utf = head.utf8();
+				uint64_t begin = OS::get_singleton()->get_ticks_usec();
+				bool ok = peer->put_data((const uint8_t*)head_utf.get_data(), head_utf.length()) == OK &&
+						peer->put_data(r.body.ptr(), r.body.size()) == OK &&
+						_read_response(peer);
+				if (ok) {
+					w->latencies.push_back(uint32_t(OS::get_singleton()->get_ticks_usec() - begin));
+				} else {
+					w->errors++;
+					peer->disconnect_from_host();
+				}
+			}
+			if (peer.is_valid())
+				peer->disconnect_from_host();
+		}
+
+		Dictionary _distribution(Vector<uint32_t> p_latencies) {
+			Dictionary d;
+			d["count"] = p_latencies.size();
+			if (p_latencies.empty())
+				return d;
+			p_latencies.sort();
+			uint64_t total = 0;
+			for (int i = 0; i < p_latencies.size(); i++)
+				total += p_latencies[i];
+			auto percentile = [&p_latencies](float p) -> int {
+				int idx = CLAMP(int(p * (p_latencies.size() - 1) + 0.5f), 0, p_latencies.size() - 1);
+				return p_latencies[idx];
+			};
+			d["mean_usec"] = int(total / p_latencies.size());
+			d["p50_usec"] = percentile(0.5);
+			d["p90_usec"] = percentile(0.9);
+			d["p99_usec"] = percentile(0.99);
+			d["max_usec"] = int(p_latencies[p_latencies.size() - 1]);
+			return d;
+		}
+	}
+
+	Dictionary TrafficReplay::replay(const String &p_path, const Options &p_options) {
+		Dictionary result;
+		Vector<TrafficCapture::Record> records;
+		Error err = TrafficCapture::load(p_path, records);
+		result["done"] = err == OK;
+		if (err != OK)
+			return result;
+
+		Options options = p_options;
+		options.concurrency = CLAMP(options.concurrency, 1, 64);
+
+		Vector<ReplayWorker*> workers;
+		uint64_t start = OS::get_singleton()->get_ticks_usec();
+		for (int i = 0; i < options.concurrency; i++) {
+			ReplayWorker* w = memnew(ReplayWorker);
+			w->records = &records;
+			w->options = &options;
+			w->index = i;
+			w->start_usec = start;
+			w->thread = Thread::create(_replay_worker, w);
+			workers.push_back(w);
+		}
+
+		Vector<uint32_t> replayed;
+		int errors = 0;
+		for (int i = 0; i < workers.size(); i++) {
+			Thread::wait_to_finish(workers[i]->thread);
+			memdelete(workers[i]->thread);
+			for (int j = 0; j < workers[i]->latencies.size(); j++)
+				replayed.push_back(workers[i]->latencies[j]);
+			errors += workers[i]->errors;
+			memdelete(workers[i]);
+		}
+
+		Vector<uint32_t> recorded;
+		for (int i = 0; i < records.size(); i++)
+			recorded.push_back(records[i].latency_usec);
+
+		result["requests"] = records.size();
+		result["errors"] = errors;
+		uint64_t duration = OS::get_singleton()->get_ticks_usec() - start;
+		// As a real, an int Variant overflows after about 35 minutes
+		result["duration_usec"] = double(duration);
+		result["recorded"] = _distribution(recorded);
+		result["replayed"] = _distribution(replayed);
+		return result;
+	}
+
+}
@@ -0,0 +1,59 @@
+#ifndef GD_EXPLORER_TRAFFIC_CAPTURE_H
+#define GD_EXPLORER_TRAFFIC_CAPTURE_H
+
+#include <core/ustring.h>
+#include <core/dictionary.h>
+#include <core/os/mutex.h>
+#include <core/os/file_access.h>
+
+namespace gdexplorer {
+
+	/*
+	 * Capture log: magic "GDTC", format version, then one record per request:
+	 * arrival time in usec since the capture started (64 bit), response latency in usec,
+	 * body length and the raw request body
+	 */
+	class TrafficCapture {
+	public:
+		enum { FORMAT_VERSION = 1 };
+
+		struct Record {
+			uint64_t arrival_usec;
+			uint32_t latency_usec;
+			Vector<uint8_t> body;
+		};
+
+	private:
+		static Mutex *mutex;
+		static FileAccess *file;
+		static uint64_t start_usec;
+		static int records;
+	public:
+		static void initialize();
+		static void finalize();
+
+		static Error start(const String& p_path);
+		static int stop();
+		static bool is_capturing() { return file != nullptr; }
+		static void record(uint64_t p_arrival_usec, uint64_t p_done_usec, const uint8_t* p_body, int p_len);
+
+		static Error load(const String& p_path, Vector<Record>& r_records);
+	};
+
+	// Plays a capture log back against a server and compares the latencies
+	class TrafficReplay {
+	public:
+		struct Options {
+			String host = "127.0.0.1";
+			int port = 6570;
+			// 2 plays the session twice as fast, 0 sends as fast as the workers can
+			float speed = 1.0;
+			int concurrency = 1;
+		};
+
+		static Dictionary replay(const String& p_path, const Options& p_options);
+	};
+
+}
+
+#endif // GD_EXPLORER_TRAFFIC_CAPTURE_H
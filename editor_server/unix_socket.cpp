@@ -0,0 +1,246 @@
+#include "unix_socket.h"
+
+#ifdef UNIX_ENABLED
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include <core/os/os.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#endif
+
+namespace gdexplorer {
+
+#ifdef UNIX_ENABLED
+
+	StreamPeerUnix::~StreamPeerUnix() {
+		disconnect_from_host();
+	}
+
+	void StreamPeerUnix::disconnect_from_host() {
+		if (sockfd >= 0) {
+			::close(sockfd);
+			sockfd = -1;
+		}
+	}
+
+	Error StreamPeerUnix::put_partial_data(const uint8_t *p_data, int p_bytes, int &r_sent) {
+		r_sent = 0;
+		ERR_FAIL_COND_V(sockfd < 0, ERR_UNCONFIGURED);
+		ssize_t sent = ::send(sockfd, p_data, p_bytes, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				return OK;
+			disconnect_from_host();
+			return FAILED;
+		}
+		r_sent = sent;
+		return OK;
+	}
+
+	Error StreamPeerUnix::put_data(const uint8_t *p_data, int p_bytes) {
+		while (p_bytes > 0) {
+			int sent = 0;
+			Error err = put_partial_data(p_data, p_bytes, sent);
+			if (err != OK)
+				return err;
+			p_data += sent;
+			p_bytes -= sent;
+		}
+		return OK;
+	}
+
+	Error StreamPeerUnix::put_data_gather(const uint8_t *p_head, int p_head_len, const uint8_t *p_body, int p_body_len) {
+		ERR_FAIL_COND_V(sockfd < 0, ERR_UNCONFIGURED);
+		struct iovec iov[2];
+		iov[0].iov_base = (void*)p_head;
+		iov[0].iov_len = p_head_len;
+		iov[1].iov_base = (void*)p_body;
+		iov[1].iov_len = p_body_len;
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = p_body_len > 0 ? 2 : 1;
+
+		ssize_t sent = ::sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno != EINTR && errno != EAGAIN) {
+				disconnect_from_host();
+				return FAILED;
+			}
+			sent = 0;
+		}
+		// Short write, finish what is left the plain way
+		if (sent < p_head_len) {
+			Error err = put_data(p_head + sent, p_head_len - sent);
+			if (err != OK)
+				return err;
+			sent = 0;
+		} else {
+			sent -= p_head_len;
+		}
+		return sent < p_body_len ? put_data(p_body + sent, p_body_len - sent) : OK;
+	}
+
+	Error StreamPeerUnix::get_partial_data(uint8_t *p_buffer, int p_bytes, int &r_received) {
+		r_received = 0;
+		ERR_FAIL_COND_V(sockfd < 0, ERR_UNCONFIGURED);
+		ssize_t read = ::recv(sockfd, p_buffer, p_bytes, 0);
+		if (read < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				return OK;
+			disconnect_from_host();
+			return FAILED;
+		}
+		if (read == 0) {
+			// Peer closed the connection
+			disconnect_from_host();
+			return ERR_FILE_EOF;
+		}
+		r_received = read;
+		return OK;
+	}
+
+	Error StreamPeerUnix::get_data(uint8_t *p_buffer, int p_bytes) {
+		while (p_bytes > 0) {
+			int received = 0;
+			Error err = get_partial_data(p_buffer, p_bytes, received);
+			if (err != OK)
+				return err;
+			p_buffer += received;
+			p_bytes -= received;
+		}
+		return OK;
+	}
+
+	int StreamPeerUnix::get_available_bytes() const {
+		if (sockfd < 0)
+			return 0;
+		int len = 0;
+		if (ioctl(sockfd, FIONREAD, &len) != 0)
+			return 0;
+		return len;
+	}
+
+	bool UnixSocketServer::is_supported() {
+		return true;
+	}
+
+	String UnixSocketServer::get_runtime_dir() {
+		String runtime = OS::get_singleton()->get_environment("XDG_RUNTIME_DIR");
+		struct stat st;
+		if (!runtime.empty() && ::stat(runtime.utf8().get_data(), &st) == 0 && S_ISDIR(st.st_mode) && st.st_uid == ::getuid())
+			return runtime;
+
+		String dir = "/tmp/godot-editor-server-" + itos(::getuid());
+		CharString cdir = dir.utf8();
+		if (::mkdir(cdir.get_data(), 0700) != 0 && errno != EEXIST)
+			return String();
+		// Someone else may have created it first, or put a link there
+		if (::lstat(cdir.get_data(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::getuid() || (st.st_mode & 0077))
+			return String();
+		return dir;
+	}
+
+	Error UnixSocketServer::listen(const String &p_path) {
+		stop();
+		CharString cpath = p_path.utf8();
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		ERR_FAIL_COND_V(cpath.length() >= int(sizeof(addr.sun_path)), ERR_INVALID_PARAMETER);
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, cpath.get_data(), sizeof(addr.sun_path) - 1);
+
+		struct stat st;
+		if (::lstat(cpath.get_data(), &st) == 0) {
+			if (!S_ISSOCK(st.st_mode))
+				return ERR_ALREADY_IN_USE;
+			// A previous editor that crashed leaves its socket file behind, a running one still accepts
+			int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			ERR_FAIL_COND_V(probe < 0, ERR_CANT_CREATE);
+			bool alive = ::connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+			::close(probe);
+			if (alive)
+				return ERR_ALREADY_IN_USE;
+			::unlink(cpath.get_data());
+		}
+
+		int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		ERR_FAIL_COND_V(fd < 0, ERR_CANT_CREATE);
+		// Only the user may connect, requests can write files and replay traffic
+		if (::bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::chmod(cpath.get_data(), 0600) != 0 || ::listen(fd, 16) != 0) {
+			::close(fd);
+			return ERR_CANT_CREATE;
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		listen_fd = fd;
+		path = p_path;
+		return OK;
+	}
+
+	bool UnixSocketServer::is_connection_available() const {
+		if (listen_fd < 0)
+			return false;
+		struct pollfd pfd;
+		pfd.fd = listen_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		return ::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+	}
+
+	Ref<StreamPeerUnix> UnixSocketServer::take_connection() {
+		Ref<StreamPeerUnix> conn;
+		if (listen_fd < 0)
+			return conn;
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+			return conn;
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+		int on = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+		conn = Ref<StreamPeerUnix>(memnew(StreamPeerUnix(fd)));
+		return conn;
+	}
+
+	void UnixSocketServer::stop() {
+		if (listen_fd >= 0) {
+			::close(listen_fd);
+			listen_fd = -1;
+			::unlink(path.utf8().get_data());
+		}
+		path = String();
+	}
+
+#else
+
+	StreamPeerUnix::~StreamPeerUnix() {}
+	void StreamPeerUnix::disconnect_from_host() {}
+	Error StreamPeerUnix::put_data(const uint8_t *p_data, int p_bytes) { return ERR_UNAVAILABLE; }
+	Error StreamPeerUnix::put_partial_data(const uint8_t *p_data, int p_bytes, int &r_sent) { return ERR_UNAVAILABLE; }
+	Error StreamPeerUnix::put_data_gather(const uint8_t *p_head, int p_head_len, const uint8_t *p_body, int p_body_len) { return ERR_UNAVAILABLE; }
+	Error StreamPeerUnix::get_data(uint8_t *p_buffer, int p_bytes) { return ERR_UNAVAILABLE; }
+	Error StreamPeerUnix::get_partial_data(uint8_t *p_buffer, int p_bytes, int &r_received) { return ERR_UNAVAILABLE; }
+	int StreamPeerUnix::get_available_bytes() const { return 0; }
+
+	bool UnixSocketServer::is_supported() { return false; }
+	String UnixSocketServer::get_runtime_dir() { return String(); }
+	Error UnixSocketServer::listen(const String &p_path) { return ERR_UNAVAILABLE; }
+	bool UnixSocketServer::is_connection_available() const { return false; }
+	Ref<StreamPeerUnix> UnixSocketServer::take_connection() { return Ref<StreamPeerUnix>(); }
+	void UnixSocketServer::stop() {}
+
+#endif
+
+}
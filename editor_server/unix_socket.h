@@ -0,0 +1,50 @@
+#ifndef GD_EXPLORER_UNIX_SOCKET_H
+#define GD_EXPLORER_UNIX_SOCKET_H
+
+#include <core/io/stream_peer.h>
+
+namespace gdexplorer {
+
+	// Blocking stream over a connected Unix domain socket
+	class StreamPeerUnix : public StreamPeer {
+		GDCLASS(StreamPeerUnix, StreamPeer);
+		int sockfd;
+	public:
+		virtual Error put_data(const uint8_t* p_data, int p_bytes) override;
+		virtual Error put_partial_data(const uint8_t* p_data, int p_bytes, int &r_sent) override;
+		virtual Error get_data(uint8_t* p_buffer, int p_bytes) override;
+		virtual Error get_partial_data(uint8_t* p_buffer, int p_bytes, int &r_received) override;
+		virtual int get_available_bytes() const override;
+
+		// Sends both buffers with a single vectored write
+		Error put_data_gather(const uint8_t* p_head, int p_head_len, const uint8_t* p_body, int p_body_len);
+		void disconnect_from_host();
+		bool is_connected_to_host() const { return sockfd >= 0; }
+
+		StreamPeerUnix(int p_sockfd = -1): sockfd(p_sockfd) {}
+		~StreamPeerUnix();
+	};
+
+	// Listening Unix domain socket, polled by the server thread like TCP_Server
+	class UnixSocketServer {
+		int listen_fd = -1;
+		String path;
+	public:
+		static bool is_supported();
+		// $XDG_RUNTIME_DIR, or a 0700 directory of the user's own under /tmp. Empty when neither is safe to use
+		static String get_runtime_dir();
+		// Fails with ERR_ALREADY_IN_USE while another server answers on p_path, a stale socket file is replaced
+		Error listen(const String& p_path);
+		bool is_listening() const { return listen_fd >= 0; }
+		const String& get_path() const { return path; }
+		bool is_connection_available() const;
+		Ref<StreamPeerUnix> take_connection();
+		void stop();
+
+		UnixSocketServer() {}
+		~UnixSocketServer() { stop(); }
+	};
+
+}
+
+#endif // GD_EXPLORER_UNIX_SOCKET_H
@@ -9,8 +9,12 @@
 #include <core/os/os.h>
 #include <core/globals.h>
 #include <core/io/json.h>
+#include <core/os/thread.h>
+#include <core/os/semaphore.h>
+#include <core/os/mutex.h>
 #include <tools/editor/editor_node.h>
 #include "modules/editor_server/services/editor_action_service.h"
+#include "modules/editor_server/editor_server.h"
 
 namespace gdexplorer {
 
@@ -22,8 +26,54 @@ namespace gdexplorer {
 		Variant port = 6570;
 		Variant problem_max = 100;
 		Variant highlight_res = true;
+		Variant unix_socket = false;
 		String reslang = "toml";
 		Vector<String> text_res_exts;
+
+		// Doc generation runs off the main thread once settings stop changing for a moment
+		static const int GENDOC_DEBOUNCE_MSEC = 800;
+		Thread *gendoc_thread = nullptr;
+		Semaphore *gendoc_semaphore = nullptr;
+		Mutex *gendoc_mutex = nullptr;
+		uint64_t gendoc_requested = 0;
+		// Set while a run is owed, a burst of changes posts the semaphore only once
+		bool gendoc_pending = false;
+		bool gendoc_quit = false;
+
+		void _queue_gendoc() {
+			gendoc_mutex->lock();
+			gendoc_requested = OS::get_singleton()->get_ticks_msec();
+			bool wake = !gendoc_pending;
+			gendoc_pending = true;
+			gendoc_mutex->unlock();
+			if(wake)
+				gendoc_semaphore->post();
+		}
+
+		static void _gendoc_thread(void *p_self) {
+			VSCodeToolsPlugin *self = (VSCodeToolsPlugin*)p_self;
+			while(true) {
+				self->gendoc_semaphore->wait();
+				while(!self->gendoc_quit) {
+					self->gendoc_mutex->lock();
+					uint64_t elapsed = OS::get_singleton()->get_ticks_msec() - self->gendoc_requested;
+					self->gendoc_mutex->unlock();
+					if(elapsed >= GENDOC_DEBOUNCE_MSEC)
+						break;
+					OS::get_singleton()->delay_usec((GENDOC_DEBOUNCE_MSEC - elapsed) * 1000);
+				}
+				if(self->gendoc_quit)
+					break;
+				// Changes from here on queue another run
+				self->gendoc_mutex->lock();
+				self->gendoc_pending = false;
+				self->gendoc_mutex->unlock();
+				// Skipped when the doc fingerprint matches the files already on disk
+				EditorActionService::GenDocResult result = EditorActionService::gendoc("res://.vscode/classes.json", String(), true);
+				if(!result.done)
+					ERR_PRINTS("[VSCodeTools]: Generate classes.json failed");
+			}
+		}
 	protected:
 
 		void _notification(int p_what) {
@@ -31,8 +81,10 @@ namespace gdexplorer {
 				Variant port = EditorSettings::get_singleton()->get("network/editor_server_port");
 				Variant problem_max = EditorSettings::get_singleton()->get("vscode/max_number_of_problems");
 				Variant highlight_res = EditorSettings::get_singleton()->get("vscode/highlight_resources");
-				bool changed = this->port != port || this->problem_max != problem_max || this->highlight_res != highlight_res;
+				Variant unix_socket = EditorSettings::get_singleton()->get("network/editor_server_unix_socket");
+				bool changed = this->port != port || this->problem_max != problem_max || this->highlight_res != highlight_res || this->unix_socket != unix_socket;
 				this->port = port;
+				this->unix_socket = unix_socket;
 				this->problem_max = problem_max;
 				this->highlight_res = highlight_res;
 				if(changed) {
@@ -48,7 +100,6 @@ namespace gdexplorer {
 			if(dir)
 				memdelete(dir);
 			String configfile = "res://.vscode/settings.json";
-			String docfile = "res://.vscode/classes.json";
 			FileAccess * file  = FileAccess::create_for_path(configfile);
 			int mode = 0;
 			if(file->file_exists(configfile)) {
@@ -77,6 +128,11 @@ namespace gdexplorer {
 				if(OK == JSON::parse(content,_settings, errstr, errline)) {
 					settings = _settings;
 					settings["GodotTools.editorServerPort"] = port;
+					String socket_path = unix_socket? gdexplorer::EditorServer::get_default_unix_socket_path() : String();
+					if(!socket_path.empty())
+						settings["GodotTools.editorServerSocket"] = socket_path;
+					else
+						settings.erase("GodotTools.editorServerSocket");
 					settings["GodotTools.maxNumberOfProblems"] = problem_max;
 					settings["GodotTools.editorPath"] = OS::get_singleton()->get_executable_path();
 					Dictionary associations;
@@ -97,11 +153,7 @@ namespace gdexplorer {
 				memdelete(file);
 
 				// Generate doc data into json
-				EditorActionService eas;
-				Dictionary action;
-				action["command"] = "gendoc";
-				action["path"] = docfile;
-				eas.resolve(action);
+				_queue_gendoc();
 			}
 			else {
 				if(file)
@@ -125,8 +177,18 @@ namespace gdexplorer {
 				EditorSettings::get_singleton()->set("vscode/highlight_resources", highlight_res);
 			m_notificationParam.push_back(EditorSettings::NOTIFICATION_EDITOR_SETTINGS_CHANGED);
 			EditorSettings::get_singleton()->connect("settings_changed", this, "_notification", m_notificationParam);
+			gendoc_semaphore = Semaphore::create();
+			gendoc_mutex = Mutex::create();
+			gendoc_thread = Thread::create(_gendoc_thread, this);
+		}
+		~VSCodeToolsPlugin() {
+			gendoc_quit = true;
+			gendoc_semaphore->post();
+			Thread::wait_to_finish(gendoc_thread);
+			memdelete(gendoc_thread);
+			memdelete(gendoc_semaphore);
+			memdelete(gendoc_mutex);
 		}
-		~VSCodeToolsPlugin() = default;
 	};
 }
 